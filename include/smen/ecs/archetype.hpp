@@ -0,0 +1,110 @@
+#ifndef SMEN_ECS_ARCHETYPE_HPP
+#define SMEN_ECS_ARCHETYPE_HPP
+
+#include <smen/variant/variant.hpp>
+#include <smen/ecs/entity_id.hpp>
+#include <smen/ecs/component_mask.hpp>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+
+namespace smen {
+    using ArchetypeID = uint32_t;
+    const ArchetypeID EMPTY_ARCHETYPE_ID = 0;
+
+    // sorted list of component type IDs
+    // the same type may appear more than once, as entities
+    // are allowed to hold multiple components of one type
+    using ArchetypeSignature = std::vector<VariantTypeID>;
+
+    struct ArchetypeColumnRange {
+    public:
+        size_t begin;
+        size_t end;
+
+        inline size_t size() const { return end - begin; }
+        inline bool empty() const { return begin == end; }
+    };
+
+    class Archetype {
+    public:
+        struct SignatureHashFunction {
+            size_t operator ()(const ArchetypeSignature & signature) const;
+        };
+
+    private:
+        ArchetypeID _id;
+        ArchetypeSignature _signature;
+        ComponentMask _mask;
+        std::vector<EntityID> _entities;
+        std::vector<std::vector<Variant>> _columns;
+
+        std::unordered_map<VariantTypeID, ArchetypeID> _add_edges;
+        std::unordered_map<VariantTypeID, ArchetypeID> _remove_edges;
+
+        friend class ArchetypeContainer;
+
+    public:
+        Archetype(ArchetypeID id, const ArchetypeSignature & signature);
+
+        inline ArchetypeID id() const { return _id; }
+        inline const ArchetypeSignature & signature() const { return _signature; }
+        inline const ComponentMask & mask() const { return _mask; }
+        inline const std::vector<EntityID> & entities() const { return _entities; }
+        inline size_t size() const { return _entities.size(); }
+        inline size_t column_count() const { return _columns.size(); }
+
+        inline const std::vector<Variant> & column(size_t column) const { return _columns[column]; }
+        inline const Variant & at(size_t column, size_t row) const { return _columns[column][row]; }
+        inline Variant & at(size_t column, size_t row) { return _columns[column][row]; }
+
+        bool has_type(VariantTypeID type_id) const;
+        std::optional<size_t> column_of(VariantTypeID type_id) const;
+        ArchetypeColumnRange columns_of(VariantTypeID type_id) const;
+        size_t insert_position_of(VariantTypeID type_id) const;
+
+        void reserve(size_t rows);
+
+        // row values must be passed in column order
+        size_t push_row(EntityID id, std::vector<Variant> && values);
+
+        // removes the row by swapping the last row into its place
+        // returns the values of the removed row and writes the ID of the
+        // entity that now occupies the removed row (or 0 if none) to moved_id
+        std::vector<Variant> take_row(size_t row, EntityID & moved_id);
+
+        void clear();
+    };
+
+    class ArchetypeContainer {
+    private:
+        std::vector<Archetype> _archetypes;
+        std::unordered_map<ArchetypeSignature, ArchetypeID, Archetype::SignatureHashFunction> _signature_map;
+
+        // archetypes are never destroyed, so the index of
+        // archetypes containing each type only ever grows
+        std::vector<std::vector<ArchetypeID>> _type_index;
+        static const std::vector<ArchetypeID> _empty_archetype_id_vec;
+
+        ArchetypeID _get_or_create(const ArchetypeSignature & signature);
+
+    public:
+        ArchetypeContainer();
+
+        inline const Archetype & at(ArchetypeID id) const { return _archetypes[id]; }
+        inline Archetype & at(ArchetypeID id) { return _archetypes[id]; }
+        inline const std::vector<Archetype> & archetypes() const { return _archetypes; }
+
+        // archetypes with at least one column of the given type
+        const std::vector<ArchetypeID> & archetypes_with(VariantTypeID type_id) const;
+
+        // the signature must be sorted
+        ArchetypeID with_signature(const ArchetypeSignature & signature);
+        ArchetypeID with_component(ArchetypeID src_id, VariantTypeID type_id);
+        ArchetypeID without_component(ArchetypeID src_id, VariantTypeID type_id);
+
+        void clear();
+    };
+}
+
+#endif//SMEN_ECS_ARCHETYPE_HPP
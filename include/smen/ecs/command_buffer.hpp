@@ -0,0 +1,90 @@
+#ifndef SMEN_ECS_COMMAND_BUFFER_HPP
+#define SMEN_ECS_COMMAND_BUFFER_HPP
+
+#include <smen/variant/variant.hpp>
+#include <smen/ecs/entity_id.hpp>
+#include <vector>
+#include <optional>
+
+namespace smen {
+    class Scene;
+
+    class EntityCommandBufferException : public std::runtime_error {
+    public:
+        inline EntityCommandBufferException(const std::string & msg)
+            : std::runtime_error("error in entity command buffer: " + msg) {}
+    };
+
+    enum class EntityCommandType {
+        SPAWN,
+        KILL,
+        KILL_RECURSIVE,
+        ADD_COMPONENT,
+        REMOVE_COMPONENT,
+        REMOVE_COMPONENT_OF_TYPE
+    };
+
+    struct EntityCommand {
+    public:
+        EntityCommandType type;
+        EntityID entity_id;
+        std::string name;
+        std::optional<Variant> component;
+        VariantTypeID type_id;
+    };
+
+    // records structural changes to a scene to be applied later in one batch
+    //
+    // entities spawned through the buffer don't exist until playback, so
+    // spawn returns a placeholder ID that can be used in further commands
+    // recorded into the same buffer
+    //
+    // placeholders carry a tag of the buffer and the batch they were
+    // recorded in (in the generation bits), so placeholders from another
+    // buffer or from a batch that was already played back are rejected
+    class EntityCommandBuffer {
+    private:
+        std::vector<EntityCommand> _commands;
+        EntityID _spawn_count;
+        EntityID _tag;
+
+        EntityID _resolve(const std::vector<EntityID> & spawned_ids, EntityID tag, EntityID id) const;
+        void _apply(Scene & scene, std::vector<EntityID> & spawned_ids, EntityID tag, EntityCommand & cmd) const;
+
+    public:
+        static const EntityID PLACEHOLDER_BIT = EntityID(1) << 31;
+        static const EntityID PLACEHOLDER_TAG_MASK = ENTITY_GENERATION_MASK;
+
+        static inline bool is_placeholder(EntityID id) { return (id & PLACEHOLDER_BIT) != 0; }
+        static inline EntityID placeholder_tag(EntityID id) { return (id >> ENTITY_INDEX_BITS) & PLACEHOLDER_TAG_MASK; }
+        static inline EntityID placeholder_index(EntityID id) { return id & ENTITY_INDEX_MASK; }
+
+        EntityCommandBuffer();
+
+        inline size_t size() const { return _commands.size(); }
+        inline bool empty() const { return _commands.empty(); }
+        inline const std::vector<EntityCommand> & commands() const { return _commands; }
+
+        EntityID spawn(const std::string & name = "");
+        void kill(EntityID id);
+        void kill_recursive(EntityID id);
+        void add_component(EntityID id, const Variant & component);
+        void remove_component(EntityID id, const Variant & component);
+        void remove_component(EntityID id, VariantTypeID type_id);
+
+        // applies all recorded commands in order and clears the buffer
+        // the scene defers its events during playback, so systems are
+        // notified once per kind of change for the whole buffer
+        //
+        // commands on entities that are dead by the time they're applied
+        // are skipped, and a command that throws doesn't keep the others
+        // from being applied - the first error is rethrown at the end
+        //
+        // returns the IDs of the spawned entities, in order of spawn calls
+        std::vector<EntityID> playback(Scene & scene);
+
+        void clear();
+    };
+}
+
+#endif//SMEN_ECS_COMMAND_BUFFER_HPP
@@ -0,0 +1,37 @@
+#ifndef SMEN_ECS_COMPONENT_MASK_HPP
+#define SMEN_ECS_COMPONENT_MASK_HPP
+
+#include <smen/variant/types.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace smen {
+    // bitset of component types, indexed by VariantTypeID
+    // type IDs are handed out sequentially by the VariantTypeDirectory,
+    // so in practice this is only a couple of words long
+    class ComponentMask {
+    private:
+        std::vector<uint64_t> _words;
+
+    public:
+        static const size_t BITS_PER_WORD = 64;
+
+        ComponentMask();
+
+        void set(VariantTypeID type_id);
+        void reset(VariantTypeID type_id);
+        bool test(VariantTypeID type_id) const;
+        bool empty() const;
+        // set type IDs in ascending order
+        std::vector<VariantTypeID> type_ids() const;
+
+        // whether every bit set in other is also set in this mask
+        bool contains(const ComponentMask & other) const;
+        bool intersects(const ComponentMask & other) const;
+
+        friend bool operator ==(const ComponentMask & lhs, const ComponentMask & rhs);
+        friend bool operator !=(const ComponentMask & lhs, const ComponentMask & rhs);
+    };
+}
+
+#endif//SMEN_ECS_COMPONENT_MASK_HPP
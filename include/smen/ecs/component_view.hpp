@@ -0,0 +1,163 @@
+#ifndef SMEN_ECS_COMPONENT_VIEW_HPP
+#define SMEN_ECS_COMPONENT_VIEW_HPP
+
+#include <smen/variant/variant.hpp>
+#include <smen/variant/native_type.hpp>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace smen {
+    class ComponentViewException : public std::runtime_error {
+    public:
+        inline ComponentViewException(const std::string & msg)
+            : std::runtime_error("error in component view: " + msg) {}
+    };
+
+    using ComponentViewFieldCheck = void (*)(const VariantTypeDirectory & dir, VariantTypeID type_id, const std::string & path);
+
+    struct ComponentViewField {
+    public:
+        const char * name;
+        size_t offset_bytes;
+        size_t size;
+        // throws if a field of the given variant type can't
+        // be viewed as the C++ type of this field
+        ComponentViewFieldCheck check;
+    };
+
+    // C++ side of a view, built by SMEN_COMPONENT_VIEW
+    struct ComponentViewLayout {
+    public:
+        const char * struct_name;
+        const char * type_name;
+        size_t size;
+        size_t alignment;
+        std::vector<ComponentViewField> fields;
+
+        // throws unless every field of the variant type is described
+        // at the same offset and with a matching type
+        void check(const VariantTypeDirectory & dir, VariantTypeID type_id, const std::string & path) const;
+    };
+
+    // specialized for each viewable struct through SMEN_COMPONENT_VIEW
+    template <typename T>
+    struct ComponentViewDescriptor;
+
+    template <typename T>
+    void check_component_view_field(const VariantTypeDirectory & dir, VariantTypeID type_id, const std::string & path);
+
+    // reinterprets the storage of a variant as a plain C++ struct
+    //
+    // the struct is checked against the variant type once, when the
+    // view is made, after which fields are read and written directly
+    // without going through the type directory
+    //
+    // native systems should make their views once and keep them around
+    template <typename T>
+    class ComponentView {
+    private:
+        VariantTypeID _type_id;
+
+    public:
+        // uses the type name given to SMEN_COMPONENT_VIEW
+        ComponentView(VariantTypeDirectory & dir);
+        ComponentView(const VariantTypeDirectory & dir, VariantTypeID type_id);
+
+        inline VariantTypeID type_id() const { return _type_id; }
+
+        bool applies_to(const Variant & component) const;
+
+        // the component must be a heap variant of the viewed type
+        T & get(const Variant & component) const;
+        T * try_get(const Variant & component) const;
+    };
+
+    /// TEMPLATE DEFINITIONS ///
+
+    template <typename T>
+    void check_component_view_field(const VariantTypeDirectory & dir, VariantTypeID type_id, const std::string & path) {
+        if constexpr (VariantNativeType<T>::exists) {
+            auto expected_type_id = VariantNativeType<T>::type_id(dir);
+            if (type_id != expected_type_id) {
+                throw ComponentViewException("field '" + path + "' has type '" + dir.resolve(type_id).name + "', but is viewed as '" + dir.resolve(expected_type_id).name + "'");
+            }
+        } else {
+            ComponentViewDescriptor<T>::layout().check(dir, type_id, path);
+        }
+    }
+
+    template <typename T>
+    ComponentView<T>::ComponentView(VariantTypeDirectory & dir)
+    : ComponentView(dir, dir.resolve(ComponentViewDescriptor<T>::layout().type_name).id)
+    {}
+
+    template <typename T>
+    ComponentView<T>::ComponentView(const VariantTypeDirectory & dir, VariantTypeID type_id)
+    : _type_id(type_id)
+    {
+        static_assert(std::is_standard_layout_v<T>, "viewed structs must have standard layout");
+
+        auto & layout = ComponentViewDescriptor<T>::layout();
+        layout.check(dir, type_id, dir.resolve(type_id).name);
+    }
+
+    template <typename T>
+    bool ComponentView<T>::applies_to(const Variant & component) const {
+        return component.storage_mode() == VariantStorageMode::HEAP && component.type_id() == _type_id;
+    }
+
+    template <typename T>
+    T & ComponentView<T>::get(const Variant & component) const {
+        assert(applies_to(component) && "component view used with a variant of a different type");
+        return *reinterpret_cast<T *>(component.content_ptr().ptr());
+    }
+
+    template <typename T>
+    T * ComponentView<T>::try_get(const Variant & component) const {
+        if (!applies_to(component)) return nullptr;
+        return reinterpret_cast<T *>(component.content_ptr().ptr());
+    }
+}
+
+// describes one field of a viewable struct
+// the field must have the same name as the field of the variant type
+#define SMEN_COMPONENT_VIEW_FIELD(struct_type, field_name) \
+    ::smen::ComponentViewField { \
+        .name = #field_name, \
+        .offset_bytes = offsetof(struct_type, field_name), \
+        .size = sizeof(struct_type::field_name), \
+        .check = &::smen::check_component_view_field<decltype(struct_type::field_name)> \
+    }
+
+// makes a struct viewable as the variant type with the given name
+// must be used in the global namespace, e.g.
+//
+// fields are matched by name, but each member must also sit at the
+// offset of its variant field - types loaded from scene files are built
+// with reorder_fields(), which places fields by descending alignment and
+// keeps their declared order otherwise, so the struct's members have
+// to be declared in that order as well
+//
+//     struct Position { float x; float y; };
+//     SMEN_COMPONENT_VIEW(Position, "Position",
+//         SMEN_COMPONENT_VIEW_FIELD(Position, x),
+//         SMEN_COMPONENT_VIEW_FIELD(Position, y)
+//     )
+#define SMEN_COMPONENT_VIEW(struct_type, variant_type_name, ...) \
+    template <> \
+    struct smen::ComponentViewDescriptor<struct_type> { \
+        static const ::smen::ComponentViewLayout & layout() { \
+            static const ::smen::ComponentViewLayout layout = { \
+                .struct_name = #struct_type, \
+                .type_name = variant_type_name, \
+                .size = sizeof(struct_type), \
+                .alignment = alignof(struct_type), \
+                .fields = { __VA_ARGS__ } \
+            }; \
+            return layout; \
+        } \
+    };
+
+#endif//SMEN_ECS_COMPONENT_VIEW_HPP
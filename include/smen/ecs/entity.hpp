@@ -3,33 +3,41 @@
 
 #include <smen/variant/variant.hpp>
 #include <smen/event.hpp>
-#include <unordered_map>
-#include <unordered_set>
 #include <smen/ecs/entity_id.hpp>
+#include <smen/ecs/archetype.hpp>
 
 namespace smen {
     class Entity {
     private:
-        std::unordered_map<VariantTypeID, Variant> _component_by_type_map;
-        std::unordered_set<Variant, Variant::HashFunction> _components;
-        std::string _name;
+        // names are interned by the entity container,
+        // this points to the key of its name index
+        const std::string * _name;
+        size_t _name_pos;
+        ArchetypeID _archetype_id;
+        size_t _row;
 
     public:
-        Entity(const std::string & name);
+        Entity(const std::string * name, size_t name_pos, ArchetypeID archetype_id, size_t row);
         Entity(const Entity &) = delete;
         Entity(Entity &&) = default;
         Entity & operator=(const Entity &) = delete;
         Entity & operator=(Entity &&) = default;
 
-        inline const std::string & name() const { return _name; }
-        inline void set_name(const std::string & new_name) { _name = new_name; }
+        inline const std::string & name() const { return *_name; }
 
-        const std::unordered_set<Variant, Variant::HashFunction> & all_components() const;
-        void add_component(const Variant & comp);
-        bool remove_component(const Variant & comp);
-        bool has_component(VariantTypeID type_id) const;
-        std::optional<Variant> get_component(VariantTypeID type_id) const;
-        std::vector<Variant> get_components(VariantTypeID type_id) const;
+        // position of the entity in the list of entities with its name
+        inline size_t name_pos() const { return _name_pos; }
+        inline void rename(const std::string * name, size_t name_pos) {
+            _name = name;
+            _name_pos = name_pos;
+        }
+
+        inline ArchetypeID archetype_id() const { return _archetype_id; }
+        inline size_t row() const { return _row; }
+        inline void move_to(ArchetypeID archetype_id, size_t row) {
+            _archetype_id = archetype_id;
+            _row = row;
+        }
     };
 }
 
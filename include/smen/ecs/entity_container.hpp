@@ -3,29 +3,93 @@
 
 #include <vector>
 #include <optional>
+#include <unordered_map>
 #include <smen/ecs/entity.hpp>
 #include <smen/ecs/entity_id.hpp>
+#include <smen/ecs/archetype.hpp>
 #include <smen/event.hpp>
 
 namespace smen {
+    struct EntitySlot {
+    public:
+        EntityGeneration generation;
+        // only meaningful while the slot is in the free queue
+        EntityIndex next_free;
+        // position of the entity in the packed array of live IDs,
+        // only meaningful while the slot is in use
+        size_t live_index;
+        std::optional<Entity> entity;
+    };
+
     class EntityContainer {
     private:
-        static const size_t ALLOC_COUNT_TO_RECLAIM = 64;
-        size_t _alloc_count;
-        size_t _pos;
-        std::vector<std::optional<Entity>> _entities;
-        void _move_to_first_empty_spot();
+        static const EntityIndex NO_FREE_SLOT = static_cast<EntityIndex>(-1);
+
+        // freed slots are reused in the order they were freed, and only
+        // once this many are waiting, so that a slot goes through many
+        // other kills before its generation is bumped again
+        // with 11 generation bits, a slot then lasts for at least ~2M
+        // kills before it's retired
+        static const EntityIndex MIN_FREE_SLOTS_BEFORE_REUSE = 1024;
+
+        std::vector<EntitySlot> _slots;
+        EntityIndex _free_head;
+        EntityIndex _free_tail;
+        EntityIndex _free_count;
+        std::vector<EntityID> _live_ids;
+        ArchetypeContainer _archetypes;
+
+        // entities by name, the keys double as interned name storage
+        std::unordered_map<std::string, std::vector<EntityID>> _name_index;
+        static const std::vector<EntityID> _empty_id_vec;
+
+        const EntitySlot * _live_slot(EntityID id) const;
+        EntitySlot * _live_slot(EntityID id);
+        void _free_slot(EntityIndex index);
+        void _push_free_slot(EntityIndex index);
+        EntityIndex _pop_free_slot();
+        void _link_name(EntityID id, Entity & ent, const std::string & name);
+        void _unlink_name(Entity & ent);
+        void _move_entity(EntityID id, Entity & ent, ArchetypeID dst_id, std::vector<Variant> && values);
 
     public:
         EntityContainer();
 
         EntityID add_entity(const std::string & name);
+        // adds the entity straight into the archetype, instead of moving
+        // it through an archetype for every component
+        // values must be passed in the archetype's column order
+        EntityID add_entity(const std::string & name, ArchetypeID archetype_id, std::vector<Variant> && values);
         const Entity & get_entity(EntityID id) const;
         Entity & get_entity(EntityID id);
         bool remove_entity(EntityID id);
         bool has_entity(EntityID id) const;
         bool is_valid_entity_slot(EntityID id) const;
-        EntityID max_entity_id() const;
+
+        inline size_t size() const { return _live_ids.size(); }
+
+        // IDs of all live entities, packed but in no particular order
+        inline const std::vector<EntityID> & live_ids() const { return _live_ids; }
+
+        void set_name(EntityID id, const std::string & name);
+        const std::vector<EntityID> & entities_named(const std::string & name) const;
+
+        inline const ArchetypeContainer & archetypes() const { return _archetypes; }
+        const Archetype & archetype_of(EntityID id) const;
+        ArchetypeID archetype_with(ArchetypeSignature signature);
+
+        // makes room for count more entities in the archetype
+        void reserve(ArchetypeID archetype_id, size_t count);
+
+        bool add_component(EntityID id, const Variant & comp);
+        bool remove_component(EntityID id, const Variant & comp);
+        std::optional<Variant> remove_component(EntityID id, VariantTypeID type_id);
+        bool has_component(EntityID id, VariantTypeID type_id) const;
+        const Variant * find_component(EntityID id, VariantTypeID type_id) const;
+        std::optional<Variant> get_component(EntityID id, VariantTypeID type_id) const;
+        std::vector<Variant> get_components(EntityID id, VariantTypeID type_id) const;
+        std::vector<Variant> get_components(EntityID id) const;
+
         void clear();
     };
 }
@@ -7,6 +7,47 @@
 
 namespace smen {
     using EntityID = uint32_t;
+    using EntityIndex = uint32_t;
+    using EntityGeneration = uint32_t;
+
+    // entity IDs are generational handles: the low bits index the slot
+    // in the entity container, while the high bits hold the generation
+    // of the slot at the time the entity was created
+    //
+    // a slot's generation changes every time its entity is removed, which
+    // makes IDs of removed entities stale instead of aliasing new ones
+    //
+    // the top bit is reserved for placeholder IDs in command buffers
+    const uint32_t ENTITY_INDEX_BITS = 20;
+    const uint32_t ENTITY_GENERATION_BITS = 11;
+    const EntityIndex ENTITY_INDEX_MASK = (uint32_t(1) << ENTITY_INDEX_BITS) - 1;
+    const EntityGeneration ENTITY_GENERATION_MASK = (uint32_t(1) << ENTITY_GENERATION_BITS) - 1;
+    const EntityIndex MAX_ENTITY_COUNT = ENTITY_INDEX_MASK + 1;
+
+    // generations start at 1, so that a valid ID is never 0
+    const EntityGeneration FIRST_ENTITY_GENERATION = 1;
+
+    // slots whose generation would wrap around are retired instead of
+    // reused, as wrapping would let stale IDs alias new entities again
+    // this value doesn't fit in the generation bits, so no ID ever has it
+    const EntityGeneration RETIRED_ENTITY_GENERATION = ENTITY_GENERATION_MASK + 1;
+
+    inline EntityIndex entity_index(EntityID id) {
+        return id & ENTITY_INDEX_MASK;
+    }
+
+    inline EntityGeneration entity_generation(EntityID id) {
+        return (id >> ENTITY_INDEX_BITS) & ENTITY_GENERATION_MASK;
+    }
+
+    inline EntityID make_entity_id(EntityIndex index, EntityGeneration generation) {
+        return (generation << ENTITY_INDEX_BITS) | index;
+    }
+
+    inline EntityGeneration next_entity_generation(EntityGeneration generation) {
+        if (generation >= ENTITY_GENERATION_MASK) return RETIRED_ENTITY_GENERATION;
+        return generation + 1;
+    }
     /* struct EntityID { */
     /* public: */
     /*     const uint32_t id; */
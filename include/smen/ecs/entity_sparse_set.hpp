@@ -0,0 +1,45 @@
+#ifndef SMEN_ECS_ENTITY_SPARSE_SET_HPP
+#define SMEN_ECS_ENTITY_SPARSE_SET_HPP
+
+#include <smen/ecs/entity_id.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace smen {
+    // set of entity IDs with constant time insertion, removal and lookup
+    // members are kept packed in a dense array for iteration, the sparse
+    // array maps the index of an entity ID to its position in the dense array
+    //
+    // only one generation of an entity index can be in the set at a time
+    class EntitySparseSet {
+    private:
+        std::vector<EntityID> _dense;
+        std::vector<size_t> _sparse;
+
+    public:
+        static const size_t NOT_PRESENT = static_cast<size_t>(-1);
+
+        EntitySparseSet();
+
+        bool contains(EntityID id) const;
+
+        // returns false if the ID was already in the set
+        bool insert(EntityID id);
+
+        // removal swaps the last member into the removed slot, so it
+        // doesn't preserve insertion order
+        // returns false if the ID wasn't in the set
+        bool erase(EntityID id);
+
+        void clear();
+
+        inline size_t size() const { return _dense.size(); }
+        inline bool empty() const { return _dense.empty(); }
+        inline const std::vector<EntityID> & dense() const { return _dense; }
+
+        inline std::vector<EntityID>::const_iterator begin() const { return _dense.begin(); }
+        inline std::vector<EntityID>::const_iterator end() const { return _dense.end(); }
+    };
+}
+
+#endif//SMEN_ECS_ENTITY_SPARSE_SET_HPP
@@ -0,0 +1,79 @@
+#ifndef SMEN_ECS_HIERARCHY_HPP
+#define SMEN_ECS_HIERARCHY_HPP
+
+#include <smen/ecs/entity_id.hpp>
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+namespace smen {
+    class SceneHierarchyException : public std::runtime_error {
+    public:
+        inline SceneHierarchyException(const std::string & msg)
+            : std::runtime_error("error in scene hierarchy: " + msg) {}
+    };
+
+    // links of an entity in the hierarchy, 0 stands for no link
+    // id is 0 for entities without a parent or children
+    struct SceneHierarchyNode {
+    public:
+        EntityID id;
+        EntityID parent;
+        EntityID first_child;
+        EntityID last_child;
+        EntityID prev_sibling;
+        EntityID next_sibling;
+    };
+
+    struct SceneHierarchyEntry {
+    public:
+        EntityID id;
+        // relative to the root the entries were collected from
+        unsigned int depth;
+    };
+
+    // parent/child relationships between entities, stored as
+    // intrusive sibling lists in an array indexed by entity index
+    //
+    // attaching and detaching are constant time, so children
+    // keep the order in which they were attached
+    class SceneHierarchy {
+    private:
+        std::vector<SceneHierarchyNode> _nodes;
+
+        const SceneHierarchyNode * _find(EntityID id) const;
+        SceneHierarchyNode & _get_or_create(EntityID id);
+        SceneHierarchyNode & _at(EntityID id);
+        void _unlink(SceneHierarchyNode & node);
+        void _release_if_unlinked(SceneHierarchyNode & node);
+
+    public:
+        SceneHierarchy();
+
+        EntityID parent_of(EntityID id) const;
+        EntityID first_child_of(EntityID id) const;
+        EntityID next_sibling_of(EntityID id) const;
+        bool has_children(EntityID id) const;
+        bool has_parent(EntityID id) const;
+        bool is_ancestor_of(EntityID ancestor_id, EntityID id) const;
+        std::vector<EntityID> children_of(EntityID id) const;
+
+        // detaches child from its current parent, if any,
+        // and appends it to the children of parent
+        void attach(EntityID parent_id, EntityID child_id);
+        void detach(EntityID child_id);
+
+        // detaches the entity and turns its children into roots
+        void remove(EntityID id);
+
+        // the entity followed by all of its descendants, with every
+        // parent placed right before its subtree and children in order
+        // built on every call by walking the sibling links without
+        // recursing, so deep hierarchies can't overflow the stack
+        std::vector<SceneHierarchyEntry> depth_order(EntityID root_id) const;
+
+        void clear();
+    };
+}
+
+#endif//SMEN_ECS_HIERARCHY_HPP
@@ -0,0 +1,62 @@
+#ifndef SMEN_ECS_PREFAB_HPP
+#define SMEN_ECS_PREFAB_HPP
+
+#include <smen/variant/variant.hpp>
+#include <smen/ecs/entity_id.hpp>
+#include <vector>
+#include <string>
+
+namespace smen {
+    class Scene;
+
+    class PrefabException : public std::runtime_error {
+    public:
+        inline PrefabException(const std::string & msg)
+            : std::runtime_error("error in prefab: " + msg) {}
+    };
+
+    struct PrefabNode {
+    public:
+        static const size_t NO_PARENT = SIZE_MAX;
+
+        std::string name;
+        // index of the parent node, parents always come before their children
+        size_t parent;
+        // in the column order of the archetype they were captured from
+        std::vector<Variant> components;
+    };
+
+    // snapshot of an entity subtree and its components that
+    // can be instantiated any number of times
+    //
+    // components are cloned when captured, so later changes to the
+    // source entities don't affect the prefab, and cloned again for every
+    // instance, so instances never share component storage
+    class Prefab {
+    private:
+        std::vector<PrefabNode> _nodes;
+
+    public:
+        Prefab();
+
+        static Prefab capture(const Scene & scene, EntityID root_id);
+
+        inline const std::vector<PrefabNode> & nodes() const { return _nodes; }
+        inline size_t size() const { return _nodes.size(); }
+        inline bool empty() const { return _nodes.empty(); }
+
+        // spawns a copy of the subtree and returns the ID of its root
+        // the scene's events for the whole subtree fire once
+        EntityID instantiate(Scene & scene) const;
+
+        // spawns count copies of the subtree, events for all of
+        // them fire once at the end
+        //
+        // the archetype of every node is looked up once, and storage for
+        // all copies is reserved before any of them are spawned, so each
+        // entity is placed into its final archetype in one step
+        std::vector<EntityID> instantiate(Scene & scene, size_t count) const;
+    };
+}
+
+#endif//SMEN_ECS_PREFAB_HPP
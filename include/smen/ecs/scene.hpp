@@ -9,7 +9,12 @@
 #include <smen/ecs/entity_container.hpp>
 #include <smen/ecs/system_query.hpp>
 #include <smen/ecs/system.hpp>
+#include <smen/ecs/system_scheduler.hpp>
+#include <smen/ecs/command_buffer.hpp>
+#include <smen/ecs/hierarchy.hpp>
+#include <smen/thread_pool.hpp>
 #include <smen/event.hpp>
+#include <span>
 
 namespace smen {
     class SceneException : public std::runtime_error {
@@ -18,33 +23,95 @@ namespace smen {
             : std::runtime_error("error in scene: " + msg) {}
     };
 
+    // iterates over the packed array of live entity IDs
+    //
+    // spawning and killing the current entity while iterating are safe
+    // killing removes by swapping the last live ID into the freed position,
+    // so killing an entity that was already visited moves an unvisited one
+    // behind the iterator, where it's skipped
+    // iterate over a copy of entity_container().live_ids() to kill freely
     class SceneIterator {
     private:
         const EntityContainer & _container;
-        EntityID _cur;
+        size_t _pos;
+        // ID at _pos when the iterator got there, if it's no longer there
+        // the entity was killed and another one took its place
+        EntityID _current_id;
+
+        EntityID _id_at_pos() const;
 
     public:
         using iterator_category = std::input_iterator_tag;
-        using difference_type = EntityID;
+        using difference_type = std::ptrdiff_t;
         using value_type = EntityID;
-        using pointer = value_type *;
+        using pointer = const value_type *;
         using reference = const value_type &;
 
         SceneIterator(const EntityContainer & container);
-        SceneIterator(const EntityContainer & container, EntityID cur);
+        SceneIterator(const EntityContainer & container, size_t pos);
 
-        inline reference operator*() const { return _cur; }
-        inline pointer operator->() { return &_cur; }
+        inline reference operator*() const { return _container.live_ids()[_pos]; }
+        inline pointer operator->() const { return &_container.live_ids()[_pos]; }
 
         SceneIterator & operator++();
         SceneIterator & operator++(int);
 
+        inline bool at_end() const { return _pos >= _container.size(); }
+
+        // entities may be killed while iterating, which shrinks the
+        // live array, so any position past its end compares equal
         inline friend bool operator ==(const SceneIterator & lhs, const SceneIterator & rhs) {
-            return &lhs._container == &rhs._container && lhs._cur == rhs._cur;
+            if (&lhs._container != &rhs._container) return false;
+            if (lhs.at_end() || rhs.at_end()) return lhs.at_end() && rhs.at_end();
+            return lhs._pos == rhs._pos;
         }
     };
 
+    class Scene;
+
+    enum class SceneEventType {
+        ENTITY_ADDED,
+        COMPONENT_ADDED,
+        COMPONENT_REMOVED,
+        ENTITY_REMOVED
+    };
+
+    struct ComponentChange {
+    public:
+        EntityID entity_id;
+        Variant component;
+    };
+
+    // structural changes accumulated while the scene is deferring events
+    struct SceneEventBatch {
+    public:
+        std::vector<EntityID> added_entities;
+        std::vector<ComponentChange> added_components;
+        std::vector<ComponentChange> removed_components;
+        std::vector<EntityID> removed_entities;
+
+        bool empty() const;
+        void clear();
+    };
+
+    // while at least one guard is alive, structural changes to the scene
+    // are still applied to storage immediately, but the events that
+    // notify systems of them are queued and only fired once the
+    // outermost guard is destroyed
+    //
+    // this keeps the system membership sets stable while systems
+    // are iterating over them
+    struct SceneDeferScopeGuard {
+    public:
+        Scene & scene;
+        SceneDeferScopeGuard(Scene & scene);
+        ~SceneDeferScopeGuard();
+    };
+
     class Scene {
+        friend struct SceneDeferScopeGuard;
+        friend class Prefab;
+
         // events must appear before any members that
         // may contain EventHolders of these events,
         // as class members are destroyed in reverse order
@@ -56,10 +123,12 @@ namespace smen {
         // have a no-param initializer anyway so we don't
         // have to worry about them
     public:
-        Event<Scene, EntityID> entity_added;
-        Event<Scene, EntityID, Variant &> component_added;
-        Event<Scene, EntityID, Variant &> component_removed;
-        Event<Scene, EntityID> entity_removed;
+        // structural events are delivered in batches, which hold
+        // a single entry unless the scene was deferring events
+        Event<Scene, std::span<const EntityID>> entity_added;
+        Event<Scene, std::span<const ComponentChange>> component_added;
+        Event<Scene, std::span<const ComponentChange>> component_removed;
+        Event<Scene, std::span<const EntityID>> entity_removed;
         Event<Scene, double> on_process;
         Event<Scene> on_render;
 
@@ -74,17 +143,32 @@ namespace smen {
         EventHolder _ev;
         bool _enabled;
         size_t _total_entity_count;
+        size_t _defer_depth;
+        SceneEventBatch _deferred_events;
 
-        static const std::vector<EntityID> _empty_id_vec;
-
+        SystemScheduler _scheduler;
+        std::unique_ptr<ThreadPool> _thread_pool;
+        EntityCommandBuffer _commands;
+        std::vector<EntityCommandBuffer> _worker_commands;
 
         std::unordered_map<std::string, LuaScript> _script_map;
-        std::unordered_map<EntityID, std::vector<EntityID>> _child_map;
-        std::unordered_map<EntityID, EntityID> _parent_map;
+        SceneHierarchy _hierarchy;
         
         std::string _name;
 
-        void _debug_hierarchy(std::ostream & s, unsigned int indent, EntityID id);
+        void _debug_hierarchy_entry(std::ostream & s, unsigned int indent, EntityID id);
+
+        void _emit(SceneEventType type, EntityID entity_id, Variant * component = nullptr);
+        void _fire(const SceneEventBatch & batch);
+        void _begin_deferring();
+        void _end_deferring();
+
+        // spawns an entity that already has all of its components,
+        // which must be in the column order of the archetype
+        EntityID _spawn_into(const std::string & name, ArchetypeID archetype_id, std::vector<Variant> && components);
+
+        void _play_back_commands();
+        void _process_systems(double delta);
 
     public:
         Scene(const std::string & name, VariantTypeDirectory & variant_type_dir);
@@ -104,14 +188,24 @@ namespace smen {
         inline LuaVariantLibrary & smen_library() { return _lua_smen_lib; }
 
         inline size_t total_entity_count() const { return _total_entity_count; }
+        inline bool deferring() const { return _defer_depth > 0; }
 
         inline VariantContainer & variant_container() { return _variant_container; }
         inline EntityContainer & entity_container() { return _entity_container; }
         inline SystemContainer & system_container() { return _system_container; }
         inline VariantTypeDirectory & dir() { return *_dir; }
 
+        // command buffer for structural changes from systems
+        // on worker threads this is a buffer private to the thread, as the
+        // scene must not be changed directly while systems run in parallel
+        // all buffers are played back after every stage of systems
+        EntityCommandBuffer & commands();
+
+        // shared by all systems of the scene, started on first use
+        ThreadPool & thread_pool();
+
         EntityID spawn(const std::string & name = "");
-        bool is_valid_entity_id(EntityID id);
+        bool is_valid_entity_id(EntityID id) const;
         Variant add_component(EntityID id, const std::string & name);
         void add_component(EntityID id, Variant & variant);
         bool has_component(EntityID id, VariantTypeID type_id) const;
@@ -125,7 +219,8 @@ namespace smen {
         std::vector<Variant> get_components(EntityID id, const std::string & name) const;
         std::vector<Variant> get_components(EntityID id) const;
 
-        const std::vector<EntityID> & children_of(EntityID id) const;
+        inline const SceneHierarchy & hierarchy() const { return _hierarchy; }
+        std::vector<EntityID> children_of(EntityID id) const;
         bool has_children(EntityID id) const;
         std::optional<EntityID> parent_of(EntityID id) const;
         bool is_child_of(EntityID parent_id, EntityID child_id) const;
@@ -144,9 +239,15 @@ namespace smen {
         const std::string & name_of(EntityID id) const;
         void set_name(EntityID id, const std::string & name);
 
+        // false for entities that don't exist (anymore)
         bool system_query_matches(EntityID id, const SystemQuery & query) const;
         void kill(EntityID id);
 
+        // kills the entity and all of its descendants, children first
+        // entity_removed fires once for the whole subtree
+        // returns the number of entities killed
+        size_t kill_recursive(EntityID id);
+
         void new_script(const std::string & id);
         void link_script(const std::string & id, const std::string & new_path);
         void delete_script(const std::string & id);
@@ -164,6 +265,10 @@ namespace smen {
 
         void debug_hierarchy(std::ostream & s, EntityID id);
 
+        // every on_process listener runs first, then the systems run in
+        // scheduler stages - systems aren't on_process listeners, so they
+        // no longer interleave with listeners in registration order
+        // render does the same with on_render and the render functions
         void process(double delta);
         void render();
     };
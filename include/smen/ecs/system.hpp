@@ -4,10 +4,12 @@
 #include <smen/variant/variant.hpp>
 #include <smen/ecs/system_query.hpp>
 #include <smen/ecs/entity_id.hpp>
+#include <smen/ecs/entity_sparse_set.hpp>
 #include <smen/event.hpp>
 #include <smen/logger.hpp>
 #include <vector>
 #include <set>
+#include <unordered_set>
 
 namespace smen {
     class Scene;
@@ -26,12 +28,28 @@ namespace smen {
     class System {
     private:
         SystemQuery _query;
-        std::vector<EntityID> _matching_entities;
+        EntitySparseSet _matching_entities;
+
+        // component types the process function reads and writes
+        // systems that declare their access may be run concurrently
+        // with other systems they don't conflict with
+        ComponentMask _reads;
+        ComponentMask _writes;
+        bool _declares_access;
+        size_t _parallel_chunk_size;
 
         EventHolder _ev;
         const SystemContainer & _container;
+        const Scene * _scene;
+
+        void _update_membership(const Scene & scene, EntityID entity_id);
+        void _process_range(Scene & scene, size_t begin, size_t end, double delta);
 
     public:
+        // a few hundred entities per chunk keeps the work per task
+        // well above the cost of scheduling it
+        static const size_t DEFAULT_PARALLEL_CHUNK_SIZE = 256;
+
         std::string name;
         bool enabled;
         const Logger logger;
@@ -47,19 +65,67 @@ namespace smen {
         ObjectDatabaseID<SystemRenderFunction> render;
 
         inline SystemQuery query() const { return _query; }
+        inline const EntitySparseSet & matching_entities() const { return _matching_entities; }
+        inline bool initialized_in(const Scene & scene) const { return _scene == &scene; }
+
+        // a system that reads or writes anything outside of its
+        // declared access must not declare any, as it will then
+        // only ever run on the main thread
+        //
+        // declared access only covers component values - systems that
+        // may run on worker threads must not spawn, kill, add or remove
+        // components directly, but record those changes in
+        // Scene::commands, which is played back after the stage
+        System & reads(VariantTypeID type_id);
+        System & writes(VariantTypeID type_id);
+        inline bool declares_access() const { return _declares_access; }
+        inline const ComponentMask & read_mask() const { return _reads; }
+        inline const ComponentMask & write_mask() const { return _writes; }
+
+        // systems that don't declare their access or whose process
+        // function is pinned to the main thread conflict with every other
+        // system, so they always run alone and on the main thread
+        bool main_thread_only() const;
+        bool conflicts_with(const System & other) const;
+
+        // splits the matching entities into chunks that are processed
+        // concurrently, which requires the process function to be safe to
+        // call from multiple threads at once for different entities
+        // only takes effect for systems that declare their access and
+        // whose process function isn't pinned to the main thread, others
+        // keep processing their entities serially
+        // a chunk size of 0 turns parallel processing off again
+        System & parallelize(size_t chunk_size = DEFAULT_PARALLEL_CHUNK_SIZE);
+        inline size_t parallel_chunk_size() const { return _parallel_chunk_size; }
 
         void initialize_events_in(Scene & scene);
+        void run_process(Scene & scene, double delta);
+        void run_render(Scene & scene);
     };
 
     class SystemContainer {
     private:
         std::unordered_map<std::string, System> _systems;
+        // systems run in the order they were made in
+        std::vector<System *> _ordered_systems;
+        std::unordered_set<std::string> _main_thread_processes;
 
     public:
+        // process functions of systems that declare their access may be
+        // called from worker threads, and must then make structural
+        // changes through Scene::commands rather than the scene itself
         ObjectDatabase<SystemProcessFunction> process_db;
         ObjectDatabase<SystemRenderFunction> render_db;
 
+        // marks a process function as only callable from the main thread,
+        // e.g. because it calls into Lua, which isn't thread safe
+        // the mark is kept if the function is registered again under the
+        // same name, which at worst keeps a system off the worker threads
+        void pin_process_to_main_thread(const std::string & id);
+        bool is_process_pinned_to_main_thread(const std::string & id) const;
+
         inline const std::unordered_map<std::string, System> & systems() const { return _systems; }
+        inline const std::vector<System *> & ordered_systems() const { return _ordered_systems; }
 
         System & make_system(const std::string & name, const SystemQuery & query);
         bool has_system(const std::string & name);
@@ -2,9 +2,16 @@
 #define SMEN_ECS_SYSTEM_QUERY_HPP
 
 #include <smen/variant/variant.hpp>
+#include <smen/ecs/component_mask.hpp>
 #include <vector>
 
 namespace smen {
+    class SystemQueryException : public std::runtime_error {
+    public:
+        inline SystemQueryException(const std::string & msg)
+            : std::runtime_error("error in system query: " + msg) {}
+    };
+
     struct SystemQuery {
     public:
         struct HashFunction {
@@ -13,14 +20,18 @@ namespace smen {
 
     private:
         std::vector<VariantTypeID> _required_types;
+        ComponentMask _mask;
         VariantTypeDirectory & _dir;
 
     public:
         SystemQuery(VariantTypeDirectory & dir);
 
+        // throw if the type doesn't exist in the directory
         SystemQuery & require_type(VariantTypeID type_id);
         SystemQuery & require_type(const std::string & name);
         const std::vector<VariantTypeID> & required_type_ids() const;
+        inline const ComponentMask & mask() const { return _mask; }
+        bool matches(const ComponentMask & mask) const;
         void write_string(std::ostream & s) const;
         std::string to_string() const;
     };
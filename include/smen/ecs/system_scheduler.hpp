@@ -0,0 +1,37 @@
+#ifndef SMEN_ECS_SYSTEM_SCHEDULER_HPP
+#define SMEN_ECS_SYSTEM_SCHEDULER_HPP
+
+#include <smen/ecs/system.hpp>
+#include <vector>
+
+namespace smen {
+    // systems within a stage don't conflict with each other
+    // parallel stages only ever contain systems that declare their access
+    // and aren't pinned to the main thread, any other system gets a stage
+    // of its own and runs on the main thread
+    struct SystemStage {
+    public:
+        std::vector<System *> systems;
+        bool parallel;
+    };
+
+    class SystemScheduler {
+    private:
+        static const size_t NOT_SCHEDULED = static_cast<size_t>(-1);
+
+        std::vector<SystemStage> _stages;
+        std::vector<size_t> _stage_of;
+
+    public:
+        SystemScheduler();
+
+        inline const std::vector<SystemStage> & stages() const { return _stages; }
+
+        // places every system in the earliest stage after all stages that
+        // hold a conflicting system registered before it, so that
+        // conflicting systems still run in registration order
+        void build(const std::vector<System *> & systems, const Scene & scene);
+    };
+}
+
+#endif//SMEN_ECS_SYSTEM_SCHEDULER_HPP
@@ -51,10 +51,12 @@ namespace smen {
         auto it = std::find(_callbacks.begin(), _callbacks.end(), std::nullopt);
         if (it == _callbacks.end()) {
             _callbacks.emplace_back(listener);
-        } else {
-            *it = listener;
+            return _callbacks.size() - 1;
         }
-        return _callbacks.size() - 1;
+
+        // the tag has to name the reused slot, not the last one
+        *it = listener;
+        return static_cast<EventTag>(it - _callbacks.begin());
     }
 
     template <typename SenderType, typename... Args>
@@ -34,6 +34,7 @@ namespace smen {
         bool check(LuaResult & result, LuaEngine & engine, const LuaNativeFunctionArgs & args, size_t index, std::unordered_set<LuaType> lua_types) const;
         bool check(LuaResult & result, LuaEngine & engine, const LuaNativeFunctionArgs & args, size_t index, const std::string & native_type = "") const;
         LuaResult error_expected(size_t index, const std::string & text) const;
+        bool has_arg(const LuaNativeFunctionArgs & args, size_t index) const;
         const LuaObject & arg(const LuaNativeFunctionArgs & args, size_t index) const;
         const LuaObject & self(const LuaNativeFunctionArgs & args) const;
     };
@@ -57,6 +57,7 @@ namespace smen {
         VariantSerializer _variant_ser;
         size_t _parent_id_counter;
         std::unordered_map<EntityID, size_t> _parent_id_map;
+        void _serialize_entity_tree(EntityID ent_id, bool & first);
 
     public:
         SceneSerializer(std::ostream & s, Scene & scene);
@@ -8,9 +8,19 @@
 #include <smen/gui/context.hpp>
 #include <smen/lua/library.hpp>
 #include <smen/object_db.hpp>
+#include <smen/ecs/prefab.hpp>
 
 namespace smen {
     class Scene;
+
+    // prefab handle given to scripts
+    // the captured components live in the container of the scene they
+    // were captured from, so the prefab only instantiates into that scene
+    struct LuaScenePrefab {
+    public:
+        Scene * scene;
+        Prefab prefab;
+    };
     
     struct LuaVariantLibrary : public LuaLibrary {
     public:
@@ -56,6 +66,8 @@ namespace smen {
         static LuaResult _scene_adopt_child_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
         static LuaResult _scene_spawn_child_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
         static LuaResult _scene_make_orphan_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
+        static LuaResult _scene_instantiate_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
+        static LuaResult _scene_capture_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
 
         static LuaResult _scene_remove_component_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
         static LuaResult _scene_find_first_by_name_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
@@ -63,9 +75,14 @@ namespace smen {
         static LuaResult _scene_name_of_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
         static LuaResult _scene_set_name_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
         static LuaResult _scene_kill_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
+        static LuaResult _scene_kill_recursive_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
+        static LuaResult _scene_defer_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
 
         void _load_scene_support(LuaObject & table);
 
+        static LuaResult _prefab_instantiate_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
+        void _load_prefab_support(LuaObject & table);
+
         static LuaResult _renderer_render_func(LuaEngine & engine, const LuaNativeFunctionArgs & args);
         void _load_renderer_support(LuaObject & table);
 
@@ -0,0 +1,98 @@
+#ifndef SMEN_THREAD_POOL_HPP
+#define SMEN_THREAD_POOL_HPP
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <exception>
+
+namespace smen {
+    using ThreadPoolTask = std::function<void ()>;
+
+    // set of tasks that can be waited on together
+    // waiting on a group from inside a task is fine, as long
+    // as the task isn't part of the group it's waiting on
+    struct ThreadPoolTaskGroup {
+    public:
+        std::atomic<size_t> pending;
+        std::exception_ptr error;
+
+        ThreadPoolTaskGroup();
+        ThreadPoolTaskGroup(const ThreadPoolTaskGroup &) = delete;
+        ThreadPoolTaskGroup & operator =(const ThreadPoolTaskGroup &) = delete;
+    };
+
+    // fixed set of worker threads, each with its own task queue
+    //
+    // workers take tasks from the back of their own queue and steal from
+    // the front of the queues of other workers once theirs runs dry
+    // threads waiting on a group help out by stealing as well
+    class ThreadPool {
+    private:
+        struct QueuedTask {
+        public:
+            ThreadPoolTask task;
+            ThreadPoolTaskGroup * group;
+        };
+
+        struct WorkerQueue {
+        public:
+            std::mutex mutex;
+            std::deque<QueuedTask> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> _queues;
+        std::vector<std::thread> _threads;
+
+        std::mutex _state_mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::atomic<size_t> _queued;
+        std::atomic<size_t> _next_queue;
+        bool _stopping;
+        ThreadPoolTaskGroup _default_group;
+
+        bool _pop_own(size_t worker_index, QueuedTask & task);
+        bool _steal(size_t start_index, QueuedTask & task);
+        void _run(QueuedTask & task);
+        void _worker_main(size_t worker_index);
+
+    public:
+        static const size_t NOT_A_WORKER = static_cast<size_t>(-1);
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator =(const ThreadPool &) = delete;
+
+        // by default one worker per hardware thread, minus the main thread
+        explicit ThreadPool(size_t thread_count = default_thread_count());
+        ~ThreadPool();
+
+        inline size_t thread_count() const { return _threads.size(); }
+
+        void submit(ThreadPoolTaskGroup & group, ThreadPoolTask task);
+        inline void submit(ThreadPoolTask task) { submit(_default_group, std::move(task)); }
+
+        // blocks until every task in the group has finished
+        // rethrows the first exception thrown by one of them, if any
+        void wait(ThreadPoolTaskGroup & group);
+        inline void wait() { wait(_default_group); }
+
+        // index of the worker the calling thread belongs to,
+        // or NOT_A_WORKER if it isn't one of this pool's workers
+        size_t current_worker_index() const;
+
+        // true while the calling thread runs a task of any pool,
+        // including tasks a waiting thread runs to help out
+        static bool running_task();
+
+        static size_t default_thread_count();
+    };
+}
+
+#endif//SMEN_THREAD_POOL_HPP
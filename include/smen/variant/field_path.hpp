@@ -0,0 +1,82 @@
+#ifndef SMEN_VARIANT_FIELD_PATH_HPP
+#define SMEN_VARIANT_FIELD_PATH_HPP
+
+#include <smen/variant/variant.hpp>
+#include <smen/variant/native_type.hpp>
+
+namespace smen {
+    class VariantFieldPathException : public std::runtime_error {
+    public:
+        inline VariantFieldPathException(const std::string & msg)
+            : std::runtime_error("error in variant field path: " + msg) {}
+    };
+
+    // dot separated path to a (possibly nested) field, resolved once
+    // against a root type into a single offset
+    //
+    // reading and writing through the path goes straight to memory,
+    // without looking up the type or field and without touching refcounts
+    class VariantFieldPath {
+    private:
+        std::string _path;
+        VariantTypeID _root_type_id;
+        VariantTypeID _type_id;
+        VariantTypeCategory _category;
+        size_t _offset_bytes;
+        size_t _size;
+
+        void * _ptr(const Variant & variant) const;
+        void _check_category(VariantTypeCategory category) const;
+
+    public:
+        VariantFieldPath(const VariantTypeDirectory & dir, VariantTypeID root_type_id, const std::string & path);
+
+        inline const std::string & path() const { return _path; }
+        inline VariantTypeID root_type_id() const { return _root_type_id; }
+        inline VariantTypeID type_id() const { return _type_id; }
+        inline VariantTypeCategory category() const { return _category; }
+        inline size_t offset_bytes() const { return _offset_bytes; }
+        inline size_t size() const { return _size; }
+
+        // whether the variant is a heap variant of the root type
+        bool applies_to(const Variant & variant) const;
+
+        // the methods below throw for variants the path doesn't apply to
+
+        // variant referring to the field, which shares storage with the root
+        Variant get(const Variant & variant) const;
+
+        // T must be the C++ representation of the field's type,
+        // e.g. float for FLOAT32 or std::string for STRING
+        // using it with a field of any other type throws
+        template <typename T>
+        T & ref(const Variant & variant) const;
+
+        template <typename T>
+        T read(const Variant & variant) const;
+
+        template <typename T>
+        void write(const Variant & variant, const T & value) const;
+    };
+
+    /// TEMPLATE DEFINITIONS ///
+
+    template <typename T>
+    T & VariantFieldPath::ref(const Variant & variant) const {
+        static_assert(VariantNativeType<T>::exists, "fields can only be accessed as the C++ type of a builtin variant type");
+        _check_category(VariantNativeType<T>::category);
+        return *reinterpret_cast<T *>(_ptr(variant));
+    }
+
+    template <typename T>
+    T VariantFieldPath::read(const Variant & variant) const {
+        return ref<T>(variant);
+    }
+
+    template <typename T>
+    void VariantFieldPath::write(const Variant & variant, const T & value) const {
+        ref<T>(variant) = value;
+    }
+}
+
+#endif//SMEN_VARIANT_FIELD_PATH_HPP
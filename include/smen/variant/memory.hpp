@@ -2,6 +2,13 @@
 #define SMEN_VARIANT_MEMORY_HPP
 
 #include <smen/variant/types.hpp>
+#include <smen/variant/string_table.hpp>
+#include <smen/event.hpp>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <cstddef>
 
 namespace smen {
     struct VariantEntryContent {
@@ -31,43 +38,164 @@ namespace smen {
     using VariantIndex = uint32_t;
     const VariantIndex INVALID_VARIANT_INDEX = UINT32_MAX;
 
+    struct VariantTypeLayoutField {
+    public:
+        VariantTypeID type_id;
+        size_t offset_bytes;
+        size_t size;
+    };
+
+    enum class VariantLifecycleOp {
+        CONSTRUCT_STRING,
+        CONSTRUCT_LIST,
+        CONSTRUCT_REFERENCE,
+        CONSTRUCT_CUSTOM,
+
+        DESTROY_STRING,
+        DESTROY_LIST,
+        DESTROY_REFERENCE,
+        DESTROY_CUSTOM
+    };
+
+    // a single step of constructing or destroying an entry, applied
+    // to the value at offset_bytes within the content
+    struct VariantLifecycleStep {
+    public:
+        VariantLifecycleOp op;
+        size_t offset_bytes;
+        // type of the value the step applies to
+        // types are never removed from the directory, so this stays valid
+        const VariantType * type;
+        // ctor or dtor in the type's database, only used by custom steps
+        // looked up when the step runs, so callbacks registered or
+        // replaced after the layout was compiled are picked up
+        ObjectDatabaseID<VariantConstructor> callback_id;
+    };
+
+    // memory layout of the entries of a single type, compiled once
+    // when the container for the type is created, so that addressing
+    // entries doesn't need to look up the type
+    //
+    // the content of an entry starts at content_offset, aligned for its
+    // type, and the refcount sits directly before it, so that the content
+    // is always REFCOUNTER_SIZE bytes past the entry pointer
+    struct VariantTypeLayout {
+    public:
+        VariantTypeID type_id;
+        // size of the content, excluding the refcount
+        size_t size;
+        // alignment of the whole entry
+        size_t alignment;
+        size_t content_offset;
+        // distance in bytes between consecutive entries
+        size_t stride;
+        bool requires_ctor;
+        bool requires_dtor;
+        // in declaration order
+        std::vector<VariantTypeLayoutField> fields;
+
+        // nested fields flattened into the order the recursive defaults
+        // would visit them: fields before their type's own ctor, and a
+        // type's own dtor before its fields
+        // empty when entries only need the zero-fill done by alloc
+        std::vector<VariantLifecycleStep> ctor_plan;
+        std::vector<VariantLifecycleStep> dtor_plan;
+
+        static VariantTypeLayout compile(const VariantTypeDirectory & dir, const VariantType & type);
+
+        // bytes of each entry not taken up by the refcount or by
+        // top level fields (or the content of non-compound types)
+        size_t padding_bytes() const;
+    };
+
+    // stored at the start of every page, so that the index of
+    // an entry can be found from a pointer into it
+    struct VariantPageHeader {
+    public:
+        VariantIndex page_index;
+    };
+
+    // entries live in fixed size pages that are never moved or freed
+    // until the container is destroyed, so pointers to entries stay
+    // valid as the container grows
+    //
+    // pages are aligned to their own (power of two) size, which lets the
+    // page of any entry pointer be found by masking off the low bits
+    //
+    // the page table is replaced by a copy twice its size when it fills
+    // up, and replaced tables are kept around until the container is
+    // destroyed, so looking up entries never has to take a lock
+    //
+    // released entries are kept in an intrusive free list threaded
+    // through their refcount fields, see VariantEntry::FREE_BIT
+    // entries may be allocated, released and looked up from any thread
     class VariantSingleTypeContainer {
         friend class VariantContainer;
     private:
-        void * _ptr;
-        size_t _alloc_counter;
-        VariantIndex _pos;
+        const size_t _page_size;
+        const VariantIndex _entries_per_page;
+
+        // published with release ordering in the order table, page count,
+        // length, so a reader that sees an index below the length also
+        // sees a table holding its page
+        std::atomic<std::byte **> _page_table;
+        std::atomic<size_t> _page_count;
+        std::atomic<VariantIndex> _length;
+
+        // only touched with _alloc_mutex held
+        std::vector<std::unique_ptr<std::byte *[]>> _page_tables;
+        size_t _page_table_capacity;
         VariantIndex _capacity;
-        VariantIndex _length;
+        VariantIndex _free_head;
+        VariantIndex _free_count;
+        std::mutex _alloc_mutex;
+
+        static size_t _page_size_for(const VariantTypeLayout & layout);
 
         bool _enlarge();
+        std::byte * _slot_ptr(VariantIndex idx) const;
+        std::byte * _entry_ptr(VariantIndex idx) const;
+        VariantIndex _index_of_ptr(const void * ptr) const;
 
     public:
         static const size_t REFCOUNTER_SIZE = sizeof(uint32_t);
-        static const VariantIndex INITIAL_CAPACITY = 32;
-        static const VariantIndex ENLARGE_FACTOR = 2;
-        static const VariantIndex RECLAIM_THRESHOLD_FACTOR = 2;
+        static const size_t PAGE_SIZE = 16384;
+        // also keeps the first entry of each page aligned for any builtin type
+        static const size_t PAGE_HEADER_SIZE = (sizeof(VariantPageHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        // pages grow past PAGE_SIZE for types too large to fit this many entries
+        static const VariantIndex MIN_ENTRIES_PER_PAGE = 8;
+        // free list links share the refcount field with the free flag,
+        // which limits indices to 31 bits
+        static const VariantIndex NO_FREE_ENTRY = (VariantIndex(1) << 31) - 1;
+        static const size_t MIN_PAGE_TABLE_CAPACITY = 16;
 
         VariantTypeDirectory & dir;
         const VariantTypeID type_id;
+        const VariantTypeLayout layout;
 
-        const bool requires_ctor;
-        const bool requires_dtor;
-
-        VariantSingleTypeContainer(VariantSingleTypeContainer &&) = default;
+        VariantSingleTypeContainer(VariantSingleTypeContainer &&) = delete;
         VariantSingleTypeContainer(const VariantSingleTypeContainer &) = delete;
-        VariantSingleTypeContainer(VariantTypeDirectory & dir, VariantTypeID type_id, bool requires_ctor, bool requires_dtor);
+        VariantSingleTypeContainer(VariantTypeDirectory & dir, const VariantTypeLayout & layout);
 
         const VariantType & type() const;
-        size_t entry_size() const;
+        inline size_t entry_size() const { return layout.stride; }
+        inline size_t page_count() const { return _page_count.load(std::memory_order_acquire); }
+        inline size_t page_size() const { return _page_size; }
+        inline VariantIndex entries_per_page() const { return _entries_per_page; }
         VariantEntry entry_at(VariantIndex idx) const;
         VariantEntry entry_at_ptr(void * ptr) const;
         VariantIndex index_of(VariantEntry entry) const;
         VariantEntry alloc();
+        // adds pages until count entries can be allocated without
+        // enlarging the container again, free entries count towards it
+        void reserve(VariantIndex count);
         void incref(VariantEntry ent);
-        void decref(VariantEntry ent);
+        // returns the refcount before decrementing
+        uint32_t decref(VariantEntry ent);
+        // returns an entry whose refcount dropped to 0 to the free list
+        // the entry must already be destroyed
+        void free(VariantEntry ent);
         std::optional<VariantReference> reference_of(VariantEntry ent);
-        void reclaim();
 
         void debug_mem();
 
@@ -80,6 +208,11 @@ namespace smen {
 
     public:
         static const VariantEntry INVALID_ENTRY;
+        // set in the refcount field of free entries, whose remaining
+        // bits hold the index of the next free entry
+        static const uint32_t FREE_BIT = uint32_t(1) << 31;
+        static const uint32_t FREE_NEXT_MASK = FREE_BIT - 1;
+
         const VariantTypeID type_id;
 
         VariantEntry(void * entry_ptr, VariantTypeID type_id);
@@ -88,8 +221,16 @@ namespace smen {
 
         inline void * ptr() { return reinterpret_cast<void *>(_refcount); }
         inline uint32_t & refcount_field() { return *_refcount; }
+        // refcounts are only ever accessed atomically, as variants
+        // may be copied and released from multiple threads at once
+        inline std::atomic_ref<uint32_t> atomic_refcount() { return std::atomic_ref<uint32_t>(*_refcount); }
         inline uint32_t refcount() {
-            return refcount_field();
+            auto value = atomic_refcount().load(std::memory_order_relaxed);
+            if ((value & FREE_BIT) != 0) return 0;
+            return value;
+        }
+        inline bool is_free() {
+            return (atomic_refcount().load(std::memory_order_relaxed) & FREE_BIT) != 0;
         }
 
         inline VariantEntryContent content() { 
@@ -101,28 +242,45 @@ namespace smen {
 
     class VariantContainer {
     private:
-        mutable std::unordered_map<VariantTypeID, VariantSingleTypeContainer> _alloc_map;
+        // indexed by VariantTypeID, made for every type with storage as
+        // soon as it's added to the directory, so that looking containers
+        // up never modifies this, and boxed so that containers never move
+        std::vector<std::unique_ptr<VariantSingleTypeContainer>> _containers;
+        EventHolder _ev;
 
-        void _construct(const VariantType & type, VariantEntryContent content);
-        void _destroy(const VariantType & type, VariantEntryContent content);
-        void _determine_ctor_dtor_behavior(const VariantType & type, bool & requires_ctor, bool & requires_dtor) const;
+        void _create_container_of(const VariantType & type);
+        [[noreturn]] void _throw_no_container(VariantTypeID type_id) const;
+
+        void _construct(const VariantTypeLayout & layout, VariantEntryContent content);
+        void _destroy(const VariantTypeLayout & layout, VariantEntryContent content);
 
     public:
         VariantTypeDirectory & dir;
+        // backs the handles of all NAME values in the container
+        VariantStringTable strings;
 
         VariantContainer(const VariantContainer &) = delete;
-        VariantContainer(VariantContainer &&) = default;
+        // listens for new types in the directory, so it can't be moved
+        VariantContainer(VariantContainer &&) = delete;
         explicit VariantContainer(VariantTypeDirectory & dir);
         VariantEntry entry_of_content(const VariantEntryContent & content) const;
 
-        VariantSingleTypeContainer & get_container_of(VariantTypeID type_id) const;
+        inline VariantSingleTypeContainer & get_container_of(VariantTypeID type_id) const {
+            if (type_id >= _containers.size() || !_containers[type_id]) _throw_no_container(type_id);
+            return *_containers[type_id];
+        }
         VariantEntry alloc(VariantTypeID type_id);
+        // makes room for count more entries of the type ahead of
+        // allocating them one by one, does nothing for types without storage
+        void reserve(VariantTypeID type_id, size_t count);
         VariantEntry entry_at(VariantTypeID type_id, VariantIndex idx) const;
         VariantIndex index_of(VariantEntry entry) const;
         void incref(VariantEntry ent);
         void decref(VariantEntry ent);
         VariantReference reference_of(VariantEntry ent);
         VariantEntry resolve(VariantReference ref);
+
+        const VariantTypeLayout & layout_of(VariantTypeID type_id) const;
     };
 }
 
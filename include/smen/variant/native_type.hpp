@@ -0,0 +1,83 @@
+#ifndef SMEN_VARIANT_NATIVE_TYPE_HPP
+#define SMEN_VARIANT_NATIVE_TYPE_HPP
+
+#include <smen/variant/types.hpp>
+#include <smen/variant/string_table.hpp>
+#include <cstdint>
+#include <string>
+
+namespace smen {
+    // C++ types with the same in-memory representation as a builtin variant type
+    // every builtin type is the only type of its category, so checking
+    // the category of a field is enough to know it can be accessed as T
+    template <typename T>
+    struct VariantNativeType {
+        static const bool exists = false;
+    };
+
+    template <>
+    struct VariantNativeType<int32_t> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::INT32;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.int32(); }
+    };
+
+    template <>
+    struct VariantNativeType<uint32_t> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::UINT32;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.uint32(); }
+    };
+
+    template <>
+    struct VariantNativeType<int64_t> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::INT64;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.int64(); }
+    };
+
+    template <>
+    struct VariantNativeType<uint64_t> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::UINT64;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.uint64(); }
+    };
+
+    template <>
+    struct VariantNativeType<float> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::FLOAT32;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.float32(); }
+    };
+
+    template <>
+    struct VariantNativeType<double> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::FLOAT64;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.float64(); }
+    };
+
+    template <>
+    struct VariantNativeType<bool> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::BOOLEAN;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.boolean(); }
+    };
+
+    template <>
+    struct VariantNativeType<std::string> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::STRING;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.string(); }
+    };
+
+    // handles are only meaningful with the string table of the variant's container
+    template <>
+    struct VariantNativeType<VariantName> {
+        static const bool exists = true;
+        static const VariantTypeCategory category = VariantTypeCategory::NAME;
+        static VariantTypeID type_id(const VariantTypeDirectory & dir) { return dir.name(); }
+    };
+}
+
+#endif//SMEN_VARIANT_NATIVE_TYPE_HPP
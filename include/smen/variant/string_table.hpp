@@ -0,0 +1,51 @@
+#ifndef SMEN_VARIANT_STRING_TABLE_HPP
+#define SMEN_VARIANT_STRING_TABLE_HPP
+
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace smen {
+    using VariantStringHandle = uint32_t;
+
+    // handle to a string interned in the VariantStringTable of a container
+    // names are stored as just the handle, so they're cheap to copy and
+    // two names of the same container are equal if their handles are
+    struct VariantName {
+    public:
+        static const VariantStringHandle EMPTY_HANDLE = 0;
+
+        VariantStringHandle handle;
+
+        friend bool operator ==(const VariantName & lhs, const VariantName & rhs) { return lhs.handle == rhs.handle; }
+        friend bool operator !=(const VariantName & lhs, const VariantName & rhs) { return lhs.handle != rhs.handle; }
+    };
+
+    // strings are never removed, so handles and references to
+    // the strings stay valid for the lifetime of the table
+    //
+    // the empty string always has the handle 0, which lets
+    // zero-filled entries start out as empty names
+    //
+    // safe to use from multiple threads at once
+    class VariantStringTable {
+    private:
+        std::deque<std::string> _strings;
+        // keys point into _strings
+        std::unordered_map<std::string_view, VariantStringHandle> _handles;
+        mutable std::shared_mutex _mutex;
+
+    public:
+        VariantStringTable();
+        VariantStringTable(VariantStringTable && other);
+        VariantStringTable(const VariantStringTable &) = delete;
+
+        VariantName intern(std::string_view str);
+        const std::string & at(VariantName name) const;
+        size_t size() const;
+    };
+}
+
+#endif//SMEN_VARIANT_STRING_TABLE_HPP
@@ -5,10 +5,19 @@
 #include <smen/object_db.hpp>
 
 namespace smen {
+    struct VariantTypeBuilderField {
+    public:
+        std::string name;
+        VariantTypeID type_id;
+        VariantTypeFieldAttribute attributes;
+    };
+
+    // fields are placed at their natural alignment when the type is built
     class VariantTypeBuilder {
     private:
         VariantType _type;
-        size_t _cur_offset_bytes;
+        std::vector<VariantTypeBuilderField> _fields;
+        bool _reorder_fields;
 
     public:
         VariantTypeDirectory & dir;
@@ -20,7 +29,12 @@ namespace smen {
         VariantTypeBuilder & field(const std::string & name, const std::string & type_name, VariantTypeFieldAttribute attrib = VariantTypeFieldAttribute::NONE);
         VariantTypeBuilder & ctor(const ObjectDatabaseID<VariantConstructor> & ctor);
         VariantTypeBuilder & dtor(const ObjectDatabaseID<VariantDestructor> & dtor);
-        VariantType build();
+
+        // lays out fields in order of decreasing alignment to minimize padding
+        // field indices still follow declaration order
+        VariantTypeBuilder & reorder_fields(bool reorder = true);
+
+        VariantType build() const;
         VariantTypeID commit();
     };
 }
@@ -8,7 +8,10 @@
 #include <functional>
 #include <vector>
 #include <smen/object_db.hpp>
+#include <smen/event.hpp>
 #include <unordered_set>
+#include <deque>
+#include <span>
 
 namespace smen {
     enum class VariantTypeCategory {
@@ -25,6 +28,8 @@ namespace smen {
         BOOLEAN,
 
         STRING,
+        // interned string, stored as a handle into the string table of the container
+        NAME,
 
         REFERENCE,
 
@@ -133,17 +138,25 @@ namespace smen {
     };
 
     class VariantType {
-    private:
-        std::unordered_map<std::string, VariantTypeField> _field_map;
-        std::vector<std::string> _field_key_list;
+        friend class VariantTypeDirectory;
 
-        void _recalculate_total_size(const VariantTypeDirectory & dir) const;
-        mutable size_t _cached_size;
+    private:
+        // in declaration order, VariantTypeFieldIndex indexes into this
+        std::vector<VariantTypeField> _fields;
+        std::unordered_map<std::string, VariantTypeFieldIndex> _field_index_map;
+
+        // computed by the directory when the type is added, as
+        // they depend on the types of the fields
+        size_t _size;
+        size_t _alignment;
         size_t _offset_bytes_counter;
 
+        void _compute_size_and_alignment(const VariantTypeDirectory & dir);
+
     public:
         static const VariantType INVALID;
         static size_t initial_size_of_category(VariantTypeCategory category);
+        static size_t initial_alignment_of_category(VariantTypeCategory category);
 
         ObjectDatabaseID<VariantConstructor> ctor;
         ObjectDatabaseID<VariantDestructor> dtor;
@@ -160,14 +173,19 @@ namespace smen {
         VariantType(VariantTypeCategory cat, VariantTypeID element_type_id, const std::string & name);
         VariantType(VariantTypeCategory cat, const std::string & name);
 
-        size_t size(const VariantTypeDirectory & dir) const;
+        // includes padding between fields and at the end, so that
+        // the size is always a multiple of the alignment
+        // only final once the type has been added to a directory
+        inline size_t size() const { return _size; }
+        inline size_t alignment() const { return _alignment; }
         bool is_singleton_type() const;
 
         void add_field(const VariantTypeField & field);
         const VariantTypeField & field(const std::string & name) const;
         const VariantTypeField & field(VariantTypeFieldIndex idx) const;
-        const std::unordered_map<std::string, VariantTypeField> fields() const;
-        const std::vector<std::string> ordered_field_keys() const;
+        std::optional<VariantTypeFieldIndex> field_index(const std::string & name) const;
+        inline std::span<const VariantTypeField> fields() const { return _fields; }
+        inline size_t field_count() const { return _fields.size(); }
         bool is_compound_type() const;
         bool valid() const;
         void write_string(std::ostream & s) const;
@@ -208,12 +226,18 @@ namespace smen {
     };
 
     class VariantTypeDirectory {
+    public:
+        // fired right after a type is added, with its ID
+        Event<VariantTypeDirectory, VariantTypeID> type_added;
 
     private:
         VariantTypeID _id_counter;
-        std::unordered_map<VariantTypeID, VariantType> _type_map;
+        // indexed by VariantTypeID, types are never removed and a deque
+        // doesn't move its elements when growing, so references returned
+        // by resolve stay valid for the lifetime of the directory
+        std::deque<VariantType> _types;
         std::unordered_map<std::string, VariantTypeID> _type_name_map;
-        std::unordered_map<VariantTypeSpecialization, VariantType, VariantTypeSpecialization::HashFunction> _generic_type_map;
+        std::unordered_map<VariantTypeSpecialization, VariantTypeID, VariantTypeSpecialization::HashFunction> _generic_type_map;
 
         ObjectDatabaseEntry<VariantDestructor> _string_ctor;
         ObjectDatabaseEntry<VariantDestructor> _string_dtor;
@@ -232,6 +256,7 @@ namespace smen {
         VariantTypeID _string;
         VariantTypeID _reference;
         VariantTypeID _list;
+        VariantTypeID _name;
 
         VariantTypeID _add_builtin(VariantType && type);
 
@@ -244,12 +269,18 @@ namespace smen {
         VariantTypeDirectory();
 
         VariantTypeID next_id() const;
+        // types must only be added from the main thread while no systems
+        // run on worker threads, which may be resolving types at any time
         VariantTypeID add(const VariantType & type);
         const VariantType & make_generic(VariantTypeID id, VariantTypeID element_type_id);
-        const VariantType & resolve(VariantTypeID id) const;
+        inline const VariantType & resolve(VariantTypeID id) const {
+            if (id >= _types.size()) return VariantType::INVALID;
+            return _types[id];
+        }
         const VariantType & resolve(const std::string & name);
 
-        inline std::unordered_map<VariantTypeID, VariantType> types() const { return _type_map; }
+        // in order of ID
+        inline const std::deque<VariantType> & types() const { return _types; }
 
         inline VariantTypeID int32() const { return _int32; }
         inline VariantTypeID uint32() const { return _uint32; }
@@ -261,6 +292,7 @@ namespace smen {
         inline VariantTypeID string() const { return _string; }
         inline VariantTypeID reference() const { return _reference; }
         inline VariantTypeID list() const { return _list; }
+        inline VariantTypeID name() const { return _name; }
 
         inline const VariantType & int32_type() const { return resolve(_int32); }
         inline const VariantType & uint32_type() const { return resolve(_uint32); }
@@ -272,6 +304,7 @@ namespace smen {
         inline const VariantType & string_type() const { return resolve(_string); }
         inline const VariantType & reference_type() { return resolve(_reference); }
         inline const VariantType & list_type() { return resolve(_list); }
+        inline const VariantType & name_type() const { return resolve(_name); }
 
     };
     
@@ -20,6 +20,7 @@ namespace smen {
         PRIMITIVE_FLOAT64,
         PRIMITIVE_BOOLEAN,
         PRIMITIVE_STRING,
+        PRIMITIVE_NAME,
         
         HEAP
     };
@@ -53,13 +54,17 @@ namespace smen {
             double _f64;
             bool _bool;
             std::string _str;
+            VariantName _name;
         };
 
         VariantStorageMode _storage_mode;
         VariantContainer * _container;
         VariantTypeID _type_id;
+        // types live as long as their directory and never move
+        const VariantType * _type;
 
         void _sync_storage(const Variant & other);
+        void _copy_contents(const Variant & other);
         // returns whether any text has actually been written
 
     public:
@@ -70,8 +75,8 @@ namespace smen {
         inline VariantStorageMode storage_mode() const { return _storage_mode; }
         inline VariantTypeID type_id() const { return _type_id; }
         inline VariantTypeDirectory & dir() const { return _container->dir; }
-        inline const VariantType & type() const { return _container->dir.resolve(_type_id); }
-        inline VariantContainer & container() { return *_container; }
+        inline const VariantType & type() const { return *_type; }
+        inline VariantContainer & container() const { return *_container; }
 
         inline bool is_root_object() const {
             if (_storage_mode != VariantStorageMode::HEAP) return false;
@@ -92,6 +97,7 @@ namespace smen {
         Variant(VariantContainer & container, double value);
         Variant(VariantContainer & container, bool value);
         Variant(VariantContainer & container, const std::string & value);
+        Variant(VariantContainer & container, VariantName value);
 
         Variant(VariantContainer & container, const VariantEntryContent & content, VariantTypeID type_id);
 
@@ -105,6 +111,12 @@ namespace smen {
 
         VariantEntryContent content_ptr() const;
 
+        // deep copy into a newly allocated entry, so that the
+        // result shares no storage with this variant
+        // types without constructors or destructors are copied
+        // with a single memcpy, others field by field
+        Variant clone() const;
+
         bool is_default_value() const;
 
         int32_t int32() const;
@@ -121,8 +133,11 @@ namespace smen {
         void set_float64(double value);
         bool boolean() const;
         void set_boolean(bool value);
+        // also work on names, through the string table of the container
         const std::string & string() const;
         void set_string(const std::string & value);
+        VariantName name() const;
+        void set_name(VariantName value);
         Variant variant() const;
         void set_variant(const Variant & value);
         VariantReference reference() const;
@@ -0,0 +1,90 @@
+#ifndef SMEN_VARIANT_VIEW_HPP
+#define SMEN_VARIANT_VIEW_HPP
+
+#include <smen/variant/variant.hpp>
+
+namespace smen {
+    class VariantViewException : public std::runtime_error {
+    public:
+        inline VariantViewException(const std::string & msg)
+            : std::runtime_error("error in variant view: " + msg) {}
+    };
+
+    // borrowed view of a heap variant or one of its (nested) fields
+    //
+    // unlike Variant, a view doesn't hold a reference to its entry, so
+    // making, copying and walking views never touches the refcount
+    // the entry must be kept alive by something else for as long as the
+    // view is used - e.g. a component for the duration of a system tick
+    // or a variant passed to a Lua call for the duration of the call
+    //
+    // use variant() to get an owning Variant that may outlive that
+    class VariantView {
+    private:
+        void * _ptr;
+        VariantTypeID _root_type_id;
+        const VariantType * _type;
+        VariantContainer * _container;
+
+        [[noreturn]] void _throw_mismatch(const VariantType & expected) const;
+
+        template <typename T>
+        T & _as(VariantTypeCategory category, const VariantType & expected) const;
+
+    public:
+        // throws unless the variant is a heap variant, primitives
+        // are stored inline in the Variant and can't be borrowed
+        explicit VariantView(const Variant & variant);
+        VariantView(VariantContainer & container, const VariantEntryContent & content, const VariantType & type);
+
+        inline void * ptr() const { return _ptr; }
+        inline VariantTypeID type_id() const { return _type->id; }
+        inline const VariantType & type() const { return *_type; }
+        inline VariantContainer & container() const { return *_container; }
+        inline VariantEntryContent content_ptr() const { return VariantEntryContent(_ptr, _root_type_id); }
+
+        // the view must be of a COMPLEX or COMPONENT type
+        VariantView get_field(const std::string & field_name) const;
+        inline VariantView get_field(const VariantTypeField & field) const {
+            return VariantView(*_container, content_ptr().of_field(field), _container->dir.resolve(field.type_id));
+        }
+        std::optional<VariantView> try_get_field(const std::string & field_name) const;
+
+        // takes a reference to the entry
+        Variant variant() const;
+
+        // unlike Variant, views don't convert between numeric types
+        inline int32_t int32() const { return _as<int32_t>(VariantTypeCategory::INT32, _container->dir.int32_type()); }
+        inline void set_int32(int32_t value) const { _as<int32_t>(VariantTypeCategory::INT32, _container->dir.int32_type()) = value; }
+        inline uint32_t uint32() const { return _as<uint32_t>(VariantTypeCategory::UINT32, _container->dir.uint32_type()); }
+        inline void set_uint32(uint32_t value) const { _as<uint32_t>(VariantTypeCategory::UINT32, _container->dir.uint32_type()) = value; }
+        inline int64_t int64() const { return _as<int64_t>(VariantTypeCategory::INT64, _container->dir.int64_type()); }
+        inline void set_int64(int64_t value) const { _as<int64_t>(VariantTypeCategory::INT64, _container->dir.int64_type()) = value; }
+        inline uint64_t uint64() const { return _as<uint64_t>(VariantTypeCategory::UINT64, _container->dir.uint64_type()); }
+        inline void set_uint64(uint64_t value) const { _as<uint64_t>(VariantTypeCategory::UINT64, _container->dir.uint64_type()) = value; }
+        inline float float32() const { return _as<float>(VariantTypeCategory::FLOAT32, _container->dir.float32_type()); }
+        inline void set_float32(float value) const { _as<float>(VariantTypeCategory::FLOAT32, _container->dir.float32_type()) = value; }
+        inline double float64() const { return _as<double>(VariantTypeCategory::FLOAT64, _container->dir.float64_type()); }
+        inline void set_float64(double value) const { _as<double>(VariantTypeCategory::FLOAT64, _container->dir.float64_type()) = value; }
+        inline bool boolean() const { return _as<bool>(VariantTypeCategory::BOOLEAN, _container->dir.boolean_type()); }
+        inline void set_boolean(bool value) const { _as<bool>(VariantTypeCategory::BOOLEAN, _container->dir.boolean_type()) = value; }
+        inline const std::string & string() const { return _as<std::string>(VariantTypeCategory::STRING, _container->dir.string_type()); }
+        inline void set_string(const std::string & value) const { _as<std::string>(VariantTypeCategory::STRING, _container->dir.string_type()) = value; }
+        inline VariantName name() const { return _as<VariantName>(VariantTypeCategory::NAME, _container->dir.name_type()); }
+        inline void set_name(VariantName value) const { _as<VariantName>(VariantTypeCategory::NAME, _container->dir.name_type()) = value; }
+
+        // references are read only, as setting them has to
+        // go through the refcount of the referenced entry
+        VariantReference reference() const;
+    };
+
+    /// TEMPLATE DEFINITIONS ///
+
+    template <typename T>
+    T & VariantView::_as(VariantTypeCategory category, const VariantType & expected) const {
+        if (_type->category != category) _throw_mismatch(expected);
+        return *reinterpret_cast<T *>(_ptr);
+    }
+}
+
+#endif//SMEN_VARIANT_VIEW_HPP
@@ -0,0 +1,178 @@
+#include <smen/ecs/archetype.hpp>
+#include <algorithm>
+
+namespace smen {
+    size_t Archetype::SignatureHashFunction::operator ()(const ArchetypeSignature & signature) const {
+        size_t hash = signature.size();
+        for (auto & type_id : signature) {
+            hash ^= std::hash<VariantTypeID>()(type_id) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+
+    Archetype::Archetype(ArchetypeID id, const ArchetypeSignature & signature)
+    : _id(id)
+    , _signature(signature)
+    , _mask()
+    , _entities()
+    , _columns(signature.size())
+    , _add_edges()
+    , _remove_edges()
+    {
+        for (auto & type_id : signature) {
+            _mask.set(type_id);
+        }
+    }
+
+    bool Archetype::has_type(VariantTypeID type_id) const {
+        return _mask.test(type_id);
+    }
+
+    std::optional<size_t> Archetype::column_of(VariantTypeID type_id) const {
+        auto it = std::lower_bound(_signature.begin(), _signature.end(), type_id);
+        if (it == _signature.end() || *it != type_id) return std::nullopt;
+        return static_cast<size_t>(it - _signature.begin());
+    }
+
+    ArchetypeColumnRange Archetype::columns_of(VariantTypeID type_id) const {
+        auto range = std::equal_range(_signature.begin(), _signature.end(), type_id);
+        return ArchetypeColumnRange {
+            .begin = static_cast<size_t>(range.first - _signature.begin()),
+            .end = static_cast<size_t>(range.second - _signature.begin())
+        };
+    }
+
+    size_t Archetype::insert_position_of(VariantTypeID type_id) const {
+        // new components of a type go after the existing ones,
+        // so that the first column of a type is always the oldest component
+        auto it = std::upper_bound(_signature.begin(), _signature.end(), type_id);
+        return static_cast<size_t>(it - _signature.begin());
+    }
+
+    void Archetype::reserve(size_t rows) {
+        for (auto & column : _columns) {
+            column.reserve(rows);
+        }
+        _entities.reserve(rows);
+    }
+
+    size_t Archetype::push_row(EntityID id, std::vector<Variant> && values) {
+        if (values.size() != _columns.size()) {
+            throw std::runtime_error("row has " + std::to_string(values.size()) + " values, but archetype has " + std::to_string(_columns.size()) + " columns");
+        }
+
+        for (size_t i = 0; i < _columns.size(); i++) {
+            _columns[i].emplace_back(std::move(values[i]));
+        }
+        _entities.emplace_back(id);
+        return _entities.size() - 1;
+    }
+
+    std::vector<Variant> Archetype::take_row(size_t row, EntityID & moved_id) {
+        auto values = std::vector<Variant>();
+        values.reserve(_columns.size());
+
+        auto last_row = _entities.size() - 1;
+
+        for (auto & column : _columns) {
+            values.emplace_back(std::move(column[row]));
+
+            // Variant's assignment operators don't release the previous
+            // value, so the last element is moved in by reconstruction
+            if (row != last_row) {
+                std::destroy_at(&column[row]);
+                std::construct_at(&column[row], std::move(column[last_row]));
+            }
+            column.pop_back();
+        }
+
+        moved_id = 0;
+        if (row != last_row) {
+            _entities[row] = _entities[last_row];
+            moved_id = _entities[row];
+        }
+        _entities.pop_back();
+
+        return values;
+    }
+
+    void Archetype::clear() {
+        for (auto & column : _columns) {
+            column.clear();
+        }
+        _entities.clear();
+    }
+
+    const std::vector<ArchetypeID> ArchetypeContainer::_empty_archetype_id_vec = std::vector<ArchetypeID>();
+
+    ArchetypeContainer::ArchetypeContainer()
+    : _archetypes()
+    , _signature_map()
+    , _type_index()
+    {
+        _get_or_create(ArchetypeSignature());
+    }
+
+    ArchetypeID ArchetypeContainer::_get_or_create(const ArchetypeSignature & signature) {
+        auto it = _signature_map.find(signature);
+        if (it != _signature_map.end()) return it->second;
+
+        auto id = static_cast<ArchetypeID>(_archetypes.size());
+        _archetypes.emplace_back(id, signature);
+        _signature_map.emplace(signature, id);
+
+        for (size_t i = 0; i < signature.size(); i++) {
+            // the signature is sorted, so repeated types are adjacent
+            if (i > 0 && signature[i] == signature[i - 1]) continue;
+
+            auto type_id = signature[i];
+            if (type_id >= _type_index.size()) _type_index.resize(type_id + 1);
+            _type_index[type_id].emplace_back(id);
+        }
+
+        return id;
+    }
+
+    const std::vector<ArchetypeID> & ArchetypeContainer::archetypes_with(VariantTypeID type_id) const {
+        if (type_id >= _type_index.size()) return _empty_archetype_id_vec;
+        return _type_index[type_id];
+    }
+
+    ArchetypeID ArchetypeContainer::with_signature(const ArchetypeSignature & signature) {
+        return _get_or_create(signature);
+    }
+
+    ArchetypeID ArchetypeContainer::with_component(ArchetypeID src_id, VariantTypeID type_id) {
+        auto edge_it = _archetypes[src_id]._add_edges.find(type_id);
+        if (edge_it != _archetypes[src_id]._add_edges.end()) return edge_it->second;
+
+        auto signature = _archetypes[src_id]._signature;
+        auto pos = _archetypes[src_id].insert_position_of(type_id);
+        signature.insert(signature.begin() + static_cast<long>(pos), type_id);
+
+        // _get_or_create may reallocate _archetypes, don't hold references across it
+        auto dst_id = _get_or_create(signature);
+        _archetypes[src_id]._add_edges.emplace(type_id, dst_id);
+        return dst_id;
+    }
+
+    ArchetypeID ArchetypeContainer::without_component(ArchetypeID src_id, VariantTypeID type_id) {
+        auto edge_it = _archetypes[src_id]._remove_edges.find(type_id);
+        if (edge_it != _archetypes[src_id]._remove_edges.end()) return edge_it->second;
+
+        auto signature = _archetypes[src_id]._signature;
+        auto it = std::find(signature.begin(), signature.end(), type_id);
+        if (it == signature.end()) return src_id;
+        signature.erase(it);
+
+        auto dst_id = _get_or_create(signature);
+        _archetypes[src_id]._remove_edges.emplace(type_id, dst_id);
+        return dst_id;
+    }
+
+    void ArchetypeContainer::clear() {
+        for (auto & archetype : _archetypes) {
+            archetype.clear();
+        }
+    }
+}
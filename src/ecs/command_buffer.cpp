@@ -0,0 +1,171 @@
+#include <smen/ecs/command_buffer.hpp>
+#include <smen/ecs/scene.hpp>
+#include <exception>
+#include <atomic>
+
+namespace smen {
+    // every buffer takes a new tag whenever it starts a new batch
+    // the tag wraps around, so only the most recent batches are told apart
+    static std::atomic<EntityID> next_placeholder_tag = 0;
+
+    static EntityID take_placeholder_tag() {
+        return next_placeholder_tag.fetch_add(1, std::memory_order_relaxed) & EntityCommandBuffer::PLACEHOLDER_TAG_MASK;
+    }
+
+    EntityCommandBuffer::EntityCommandBuffer()
+    : _commands()
+    , _spawn_count(0)
+    , _tag(take_placeholder_tag())
+    {}
+
+    EntityID EntityCommandBuffer::_resolve(const std::vector<EntityID> & spawned_ids, EntityID tag, EntityID id) const {
+        if (!is_placeholder(id)) return id;
+
+        auto index = placeholder_index(id);
+        if (placeholder_tag(id) != tag || index >= spawned_ids.size()) {
+            throw EntityCommandBufferException("placeholder entity ID " + std::to_string(index) + " doesn't belong to this buffer");
+        }
+        return spawned_ids[index];
+    }
+
+    void EntityCommandBuffer::_apply(Scene & scene, std::vector<EntityID> & spawned_ids, EntityID tag, EntityCommand & cmd) const {
+        if (cmd.type == EntityCommandType::SPAWN) {
+            // reserve the slot first, so that if the spawn throws later
+            // placeholders still resolve to the right entities and
+            // commands on this one are skipped as dead
+            spawned_ids.emplace_back(0);
+            spawned_ids.back() = scene.spawn(cmd.name);
+            return;
+        }
+
+        // the target may have been killed by an earlier command of this
+        // or another buffer, which makes the command a no-op like a
+        // kill of an entity that's already dead
+        auto target = _resolve(spawned_ids, tag, cmd.entity_id);
+        if (!scene.is_valid_entity_id(target)) return;
+
+        switch(cmd.type) {
+        case EntityCommandType::KILL:
+            scene.kill(target);
+            break;
+        case EntityCommandType::KILL_RECURSIVE:
+            scene.kill_recursive(target);
+            break;
+        case EntityCommandType::ADD_COMPONENT:
+            scene.add_component(target, *cmd.component);
+            break;
+        case EntityCommandType::REMOVE_COMPONENT:
+            scene.remove_component(target, *cmd.component);
+            break;
+        case EntityCommandType::REMOVE_COMPONENT_OF_TYPE:
+            scene.remove_component(target, cmd.type_id);
+            break;
+        default:
+            break;
+        }
+    }
+
+    EntityID EntityCommandBuffer::spawn(const std::string & name) {
+        if (_spawn_count > ENTITY_INDEX_MASK) {
+            throw EntityCommandBufferException("too many entities spawned in one batch");
+        }
+
+        auto placeholder_id = PLACEHOLDER_BIT | (_tag << ENTITY_INDEX_BITS) | _spawn_count;
+        _spawn_count += 1;
+
+        _commands.emplace_back(EntityCommand {
+            .type = EntityCommandType::SPAWN,
+            .entity_id = placeholder_id,
+            .name = name,
+            .component = std::nullopt,
+            .type_id = 0
+        });
+        return placeholder_id;
+    }
+
+    void EntityCommandBuffer::kill(EntityID id) {
+        _commands.emplace_back(EntityCommand {
+            .type = EntityCommandType::KILL,
+            .entity_id = id,
+            .name = "",
+            .component = std::nullopt,
+            .type_id = 0
+        });
+    }
+
+    void EntityCommandBuffer::kill_recursive(EntityID id) {
+        _commands.emplace_back(EntityCommand {
+            .type = EntityCommandType::KILL_RECURSIVE,
+            .entity_id = id,
+            .name = "",
+            .component = std::nullopt,
+            .type_id = 0
+        });
+    }
+
+    void EntityCommandBuffer::add_component(EntityID id, const Variant & component) {
+        _commands.emplace_back(EntityCommand {
+            .type = EntityCommandType::ADD_COMPONENT,
+            .entity_id = id,
+            .name = "",
+            .component = component,
+            .type_id = component.type().id
+        });
+    }
+
+    void EntityCommandBuffer::remove_component(EntityID id, const Variant & component) {
+        _commands.emplace_back(EntityCommand {
+            .type = EntityCommandType::REMOVE_COMPONENT,
+            .entity_id = id,
+            .name = "",
+            .component = component,
+            .type_id = component.type().id
+        });
+    }
+
+    void EntityCommandBuffer::remove_component(EntityID id, VariantTypeID type_id) {
+        _commands.emplace_back(EntityCommand {
+            .type = EntityCommandType::REMOVE_COMPONENT_OF_TYPE,
+            .entity_id = id,
+            .name = "",
+            .component = std::nullopt,
+            .type_id = type_id
+        });
+    }
+
+    std::vector<EntityID> EntityCommandBuffer::playback(Scene & scene) {
+        auto spawned_ids = std::vector<EntityID>();
+        spawned_ids.reserve(_spawn_count);
+
+        // take the commands out first, so that the buffer can be
+        // recorded into again by listeners of the batched events
+        auto commands = std::move(_commands);
+        auto tag = _tag;
+        clear();
+
+        // a failing command doesn't stop the rest of the batch from being
+        // applied, the first error is rethrown once playback is done
+        std::exception_ptr error;
+
+        {
+            SceneDeferScopeGuard scope(scene);
+
+            for (auto & cmd : commands) {
+                try {
+                    _apply(scene, spawned_ids, tag, cmd);
+                } catch (...) {
+                    if (!error) error = std::current_exception();
+                }
+            }
+        }
+
+        if (error) std::rethrow_exception(error);
+        return spawned_ids;
+    }
+
+    void EntityCommandBuffer::clear() {
+        _commands.clear();
+        _spawn_count = 0;
+        _tag = take_placeholder_tag();
+    }
+}
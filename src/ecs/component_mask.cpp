@@ -0,0 +1,67 @@
+#include <smen/ecs/component_mask.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace smen {
+    ComponentMask::ComponentMask()
+    : _words()
+    {}
+
+    void ComponentMask::set(VariantTypeID type_id) {
+        // the mask is sized by the largest ID, so this would allocate ~512MB
+        assert(type_id != INVALID_VARIANT_TYPE_ID && "invalid type ID set in component mask");
+        auto word = type_id / BITS_PER_WORD;
+        if (word >= _words.size()) _words.resize(word + 1, 0);
+        _words[word] |= uint64_t(1) << (type_id % BITS_PER_WORD);
+    }
+
+    void ComponentMask::reset(VariantTypeID type_id) {
+        auto word = type_id / BITS_PER_WORD;
+        if (word >= _words.size()) return;
+        _words[word] &= ~(uint64_t(1) << (type_id % BITS_PER_WORD));
+    }
+
+    bool ComponentMask::test(VariantTypeID type_id) const {
+        auto word = type_id / BITS_PER_WORD;
+        if (word >= _words.size()) return false;
+        return (_words[word] & (uint64_t(1) << (type_id % BITS_PER_WORD))) != 0;
+    }
+
+    bool ComponentMask::empty() const {
+        return std::all_of(_words.begin(), _words.end(), [](uint64_t word) { return word == 0; });
+    }
+
+    std::vector<VariantTypeID> ComponentMask::type_ids() const {
+        auto type_ids = std::vector<VariantTypeID>();
+        for (size_t i = 0; i < _words.size(); i++) {
+            for (size_t bit = 0; bit < BITS_PER_WORD; bit++) {
+                if ((_words[i] & (uint64_t(1) << bit)) != 0) type_ids.emplace_back(VariantTypeID(i * BITS_PER_WORD + bit));
+            }
+        }
+        return type_ids;
+    }
+
+    bool ComponentMask::contains(const ComponentMask & other) const {
+        for (size_t i = 0; i < other._words.size(); i++) {
+            auto word = i < _words.size() ? _words[i] : 0;
+            if ((word & other._words[i]) != other._words[i]) return false;
+        }
+        return true;
+    }
+
+    bool ComponentMask::intersects(const ComponentMask & other) const {
+        auto count = std::min(_words.size(), other._words.size());
+        for (size_t i = 0; i < count; i++) {
+            if ((_words[i] & other._words[i]) != 0) return true;
+        }
+        return false;
+    }
+
+    bool operator ==(const ComponentMask & lhs, const ComponentMask & rhs) {
+        return lhs.contains(rhs) && rhs.contains(lhs);
+    }
+
+    bool operator !=(const ComponentMask & lhs, const ComponentMask & rhs) {
+        return !(lhs == rhs);
+    }
+}
@@ -0,0 +1,49 @@
+#include <smen/ecs/component_view.hpp>
+
+namespace smen {
+    void ComponentViewLayout::check(const VariantTypeDirectory & dir, VariantTypeID type_id, const std::string & path) const {
+        auto & type = dir.resolve(type_id);
+        if (!type.valid()) {
+            throw ComponentViewException("'" + path + "' has no type, but is viewed as '" + struct_name + "'");
+        }
+
+        if (!type.is_compound_type()) {
+            throw ComponentViewException("'" + path + "' has type '" + type.name + "', which has no fields, but is viewed as '" + struct_name + "'");
+        }
+
+        if (type.size() != size) {
+            throw ComponentViewException("'" + path + "' has type '" + type.name + "' of size " + std::to_string(type.size()) + ", but '" + struct_name + "' has size " + std::to_string(size));
+        }
+
+        // the content of an entry is only aligned to the alignment of its type
+        if (type.alignment() < alignment) {
+            throw ComponentViewException("'" + path + "' has type '" + type.name + "' aligned to " + std::to_string(type.alignment()) + " bytes, but '" + struct_name + "' needs " + std::to_string(alignment));
+        }
+
+        if (type.field_count() != fields.size()) {
+            throw ComponentViewException("'" + path + "' has type '" + type.name + "' with " + std::to_string(type.field_count()) + " fields, but '" + struct_name + "' describes " + std::to_string(fields.size()));
+        }
+
+        for (auto & view_field : fields) {
+            auto field_path = path + "." + view_field.name;
+
+            auto & field = type.field(view_field.name);
+            if (!field) {
+                throw ComponentViewException("type '" + type.name + "' has no field '" + view_field.name + "' (in '" + field_path + "')");
+            }
+
+            if (field.offset_bytes != view_field.offset_bytes) {
+                // usually a struct declared in source order viewing a type
+                // whose fields were reordered by alignment
+                throw ComponentViewException("field '" + field_path + "' is at offset " + std::to_string(field.offset_bytes) + ", but at offset " + std::to_string(view_field.offset_bytes) + " in '" + struct_name + "' (members must be declared in the order of the type's fields in memory)");
+            }
+
+            auto field_size = dir.resolve(field.type_id).size();
+            if (field_size != view_field.size) {
+                throw ComponentViewException("field '" + field_path + "' has size " + std::to_string(field_size) + ", but size " + std::to_string(view_field.size) + " in '" + struct_name + "'");
+            }
+
+            view_field.check(dir, field.type_id, field_path);
+        }
+    }
+}
@@ -1,97 +1,332 @@
 #include <smen/ecs/entity_container.hpp>
+#include <algorithm>
 
 namespace smen {
+    const std::vector<EntityID> EntityContainer::_empty_id_vec = std::vector<EntityID>();
+
     EntityContainer::EntityContainer()
-    : _alloc_count(0)
-    , _pos(0)
-    , _entities()
+    : _slots()
+    , _free_head(NO_FREE_SLOT)
+    , _free_tail(NO_FREE_SLOT)
+    , _free_count(0)
+    , _live_ids()
+    , _archetypes()
+    , _name_index()
     {}
 
-    void EntityContainer::_move_to_first_empty_spot() {
-        while (_pos < _entities.size() && _entities.at(_pos) != std::nullopt) {
-            _pos += 1;
-        }
+    const EntitySlot * EntityContainer::_live_slot(EntityID id) const {
+        auto index = entity_index(id);
+        if (index >= _slots.size()) return nullptr;
+
+        // free and retired slots always have a newer generation than
+        // any ID that was handed out for them, so this is enough
+        auto & slot = _slots[index];
+        if (slot.generation != entity_generation(id)) return nullptr;
+        return &slot;
+    }
+
+    EntitySlot * EntityContainer::_live_slot(EntityID id) {
+        return const_cast<EntitySlot *>(static_cast<const EntityContainer &>(*this)._live_slot(id));
+    }
+
+    void EntityContainer::_free_slot(EntityIndex index) {
+        auto & slot = _slots[index];
+
+        // swap the last live ID into the place of the removed one
+        auto last_id = _live_ids.back();
+        _live_ids[slot.live_index] = last_id;
+        _slots[entity_index(last_id)].live_index = slot.live_index;
+        _live_ids.pop_back();
+
+        slot.entity = std::nullopt;
+        slot.generation = next_entity_generation(slot.generation);
+        if (slot.generation != RETIRED_ENTITY_GENERATION) _push_free_slot(index);
+    }
+
+    void EntityContainer::_push_free_slot(EntityIndex index) {
+        _slots[index].next_free = NO_FREE_SLOT;
+        if (_free_tail == NO_FREE_SLOT) _free_head = index;
+        else _slots[_free_tail].next_free = index;
+        _free_tail = index;
+        _free_count += 1;
+    }
+
+    EntityIndex EntityContainer::_pop_free_slot() {
+        auto index = _free_head;
+        _free_head = _slots[index].next_free;
+        if (_free_head == NO_FREE_SLOT) _free_tail = NO_FREE_SLOT;
+        _free_count -= 1;
+        return index;
     }
     
-    EntityID EntityContainer::add_entity(const std::string & name) {
-        if (_alloc_count == ALLOC_COUNT_TO_RECLAIM) {
-            _alloc_count = 0;
-            _pos = 0;
-            _move_to_first_empty_spot();
+    void EntityContainer::_link_name(EntityID id, Entity & ent, const std::string & name) {
+        auto it = _name_index.try_emplace(name).first;
+        auto & ids = it->second;
+        ent.rename(&it->first, ids.size());
+        ids.emplace_back(id);
+    }
+
+    void EntityContainer::_unlink_name(Entity & ent) {
+        auto it = _name_index.find(ent.name());
+        auto & ids = it->second;
+
+        auto pos = ent.name_pos();
+        auto last_id = ids.back();
+        if (pos != ids.size() - 1) {
+            ids[pos] = last_id;
+            auto & moved_ent = get_entity(last_id);
+            moved_ent.rename(&it->first, pos);
         }
+        ids.pop_back();
+
+        if (ids.empty()) _name_index.erase(it);
+        ent.rename(nullptr, 0);
+    }
+
+    EntityID EntityContainer::add_entity(const std::string & name) {
+        return add_entity(name, EMPTY_ARCHETYPE_ID, std::vector<Variant>());
+    }
 
-        if (_pos == _entities.size()) {
-            _entities.emplace_back(std::nullopt);
+    EntityID EntityContainer::add_entity(const std::string & name, ArchetypeID archetype_id, std::vector<Variant> && values) {
+        // checked before taking a slot, so that a bad row doesn't leak one
+        if (values.size() != _archetypes.at(archetype_id).column_count()) {
+            throw std::runtime_error("entity has " + std::to_string(values.size()) + " components, but archetype has " + std::to_string(_archetypes.at(archetype_id).column_count()) + " columns");
         }
 
-        auto new_id = EntityID(static_cast<uint32_t>(_pos));
+        EntityIndex index;
+
+        // once every index is taken, any free slot has to do
+        auto can_grow = _slots.size() < MAX_ENTITY_COUNT;
+        if (_free_count > 0 && (_free_count >= MIN_FREE_SLOTS_BEFORE_REUSE || !can_grow)) {
+            index = _pop_free_slot();
+        } else {
+            if (!can_grow) {
+                throw std::runtime_error("entity limit of " + std::to_string(MAX_ENTITY_COUNT) + " reached");
+            }
+
+            index = static_cast<EntityIndex>(_slots.size());
+            _slots.emplace_back(EntitySlot {
+                .generation = FIRST_ENTITY_GENERATION,
+                .next_free = NO_FREE_SLOT,
+                .live_index = 0,
+                .entity = std::nullopt
+            });
+        }
 
-        _entities[_pos] = Entity(name);
-        _pos += 1;
+        auto & slot = _slots[index];
+        auto new_id = make_entity_id(index, slot.generation);
 
-        _alloc_count += 1;
+        auto row = _archetypes.at(archetype_id).push_row(new_id, std::move(values));
+        slot.entity = Entity(nullptr, 0, archetype_id, row);
+        _link_name(new_id, *slot.entity, name);
+        slot.live_index = _live_ids.size();
+        _live_ids.emplace_back(new_id);
 
-        return new_id + 1; // 0 is an invalid ID
+        return new_id;
     }
 
     const Entity & EntityContainer::get_entity(EntityID id) const {
         if (id == 0) throw std::runtime_error("received entity ID 0 (get_entity const)");
-        id -= 1;
 
-        if (id < _entities.size()) {
-            auto & ent = _entities[id];
-            if (ent) {
-                return *ent;
-            }
-        }
-        throw std::runtime_error("no entity with ID " + std::to_string(id));
+        auto * slot = _live_slot(id);
+        if (slot == nullptr) throw std::runtime_error("no entity with ID " + std::to_string(id));
+        return *slot->entity;
     }
 
     Entity & EntityContainer::get_entity(EntityID id) {
         if (id == 0) throw std::runtime_error("received entity ID 0 (get_entity non-const)");
-        id -= 1;
 
-        if (id < _entities.size()) {
-            auto & ent = _entities[id];
-            if (ent) {
-                return *ent;
-            }
-        }
-        throw std::runtime_error("no entity with ID " + std::to_string(id));
+        auto * slot = _live_slot(id);
+        if (slot == nullptr) throw std::runtime_error("no entity with ID " + std::to_string(id));
+        return *slot->entity;
     }
 
     bool EntityContainer::remove_entity(EntityID ent_id) {
         if (ent_id == 0) throw std::runtime_error("received entity ID 0 (remove_entity)");
-        ent_id -= 1;
 
-        if (ent_id >= _entities.size()) return false;
-        auto & ent_optional = _entities.at(ent_id);
-        if (!ent_optional) return false;
-        _entities[ent_id] = std::nullopt;
+        auto * slot = _live_slot(ent_id);
+        if (slot == nullptr) return false;
+        auto & ent = *slot->entity;
+
+        EntityID moved_id;
+        _archetypes.at(ent.archetype_id()).take_row(ent.row(), moved_id);
+        if (moved_id != 0) {
+            auto & moved_ent = get_entity(moved_id);
+            moved_ent.move_to(moved_ent.archetype_id(), ent.row());
+        }
+
+        _unlink_name(ent);
+        _free_slot(entity_index(ent_id));
         return true;
     }
 
     bool EntityContainer::has_entity(EntityID ent_id) const {
         if (ent_id == 0) throw std::runtime_error("received entity ID 0 (has_entity)");
-        ent_id -= 1;
-
-        if (ent_id >= _entities.size()) return false;
-        if (!_entities.at(ent_id)) return false;
-        return true;
+        return _live_slot(ent_id) != nullptr;
     }
 
     bool EntityContainer::is_valid_entity_slot(EntityID ent_id) const {
         if (ent_id == 0) return false;
-        if (ent_id > _entities.size()) return false;
+        if (entity_index(ent_id) >= _slots.size()) return false;
+        return true;
+    }
+
+    void EntityContainer::set_name(EntityID id, const std::string & name) {
+        auto & ent = get_entity(id);
+        if (ent.name() == name) return;
+
+        _unlink_name(ent);
+        _link_name(id, ent, name);
+    }
+
+    const std::vector<EntityID> & EntityContainer::entities_named(const std::string & name) const {
+        auto it = _name_index.find(name);
+        if (it == _name_index.end()) return _empty_id_vec;
+        return it->second;
+    }
+
+    const Archetype & EntityContainer::archetype_of(EntityID id) const {
+        return _archetypes.at(get_entity(id).archetype_id());
+    }
+
+    ArchetypeID EntityContainer::archetype_with(ArchetypeSignature signature) {
+        std::sort(signature.begin(), signature.end());
+        return _archetypes.with_signature(signature);
+    }
+
+    void EntityContainer::reserve(ArchetypeID archetype_id, size_t count) {
+        _archetypes.at(archetype_id).reserve(_archetypes.at(archetype_id).size() + count);
+        _live_ids.reserve(_live_ids.size() + count);
+    }
+
+    void EntityContainer::_move_entity(EntityID id, Entity & ent, ArchetypeID dst_id, std::vector<Variant> && values) {
+        auto row = _archetypes.at(dst_id).push_row(id, std::move(values));
+        ent.move_to(dst_id, row);
+    }
+
+    bool EntityContainer::add_component(EntityID id, const Variant & comp) {
+        auto & ent = get_entity(id);
+        auto src_id = ent.archetype_id();
+
+        auto & src = _archetypes.at(src_id);
+        auto range = src.columns_of(comp.type_id());
+        for (auto col = range.begin; col < range.end; col++) {
+            if (src.at(col, ent.row()) == comp) return false;
+        }
+
+        auto dst_id = _archetypes.with_component(src_id, comp.type_id());
+
+        // with_component may have created a new archetype,
+        // so src must be looked up again
+        auto & new_src = _archetypes.at(src_id);
+        auto insert_pos = new_src.insert_position_of(comp.type_id());
+
+        EntityID moved_id;
+        auto values = new_src.take_row(ent.row(), moved_id);
+        if (moved_id != 0) get_entity(moved_id).move_to(src_id, ent.row());
+
+        values.insert(values.begin() + static_cast<long>(insert_pos), comp);
+        _move_entity(id, ent, dst_id, std::move(values));
+        return true;
+    }
+
+    bool EntityContainer::remove_component(EntityID id, const Variant & comp) {
+        auto & ent = get_entity(id);
+        auto src_id = ent.archetype_id();
+
+        auto & src = _archetypes.at(src_id);
+        auto range = src.columns_of(comp.type_id());
+        auto remove_col = range.end;
+        for (auto col = range.begin; col < range.end; col++) {
+            if (src.at(col, ent.row()) == comp) {
+                remove_col = col;
+                break;
+            }
+        }
+        if (remove_col == range.end) return false;
+
+        auto dst_id = _archetypes.without_component(src_id, comp.type_id());
+
+        EntityID moved_id;
+        auto values = _archetypes.at(src_id).take_row(ent.row(), moved_id);
+        if (moved_id != 0) get_entity(moved_id).move_to(src_id, ent.row());
+
+        values.erase(values.begin() + static_cast<long>(remove_col));
+        _move_entity(id, ent, dst_id, std::move(values));
         return true;
     }
 
-    EntityID EntityContainer::max_entity_id() const {
-        return static_cast<EntityID>(_entities.size());
+    std::optional<Variant> EntityContainer::remove_component(EntityID id, VariantTypeID type_id) {
+        auto * comp = find_component(id, type_id);
+        if (comp == nullptr) return std::nullopt;
+
+        // the column is about to be moved, so take a copy first
+        auto removed = *comp;
+        if (!remove_component(id, removed)) return std::nullopt;
+        return removed;
+    }
+
+    bool EntityContainer::has_component(EntityID id, VariantTypeID type_id) const {
+        return archetype_of(id).has_type(type_id);
+    }
+
+    const Variant * EntityContainer::find_component(EntityID id, VariantTypeID type_id) const {
+        auto & ent = get_entity(id);
+        auto & archetype = _archetypes.at(ent.archetype_id());
+        auto col = archetype.column_of(type_id);
+        if (!col) return nullptr;
+        return &archetype.at(*col, ent.row());
+    }
+
+    std::optional<Variant> EntityContainer::get_component(EntityID id, VariantTypeID type_id) const {
+        auto * comp = find_component(id, type_id);
+        if (comp == nullptr) return std::nullopt;
+        return *comp;
+    }
+
+    std::vector<Variant> EntityContainer::get_components(EntityID id, VariantTypeID type_id) const {
+        auto & ent = get_entity(id);
+        auto & archetype = _archetypes.at(ent.archetype_id());
+        auto range = archetype.columns_of(type_id);
+
+        std::vector<Variant> components;
+        components.reserve(range.size());
+        for (auto col = range.begin; col < range.end; col++) {
+            components.emplace_back(archetype.at(col, ent.row()));
+        }
+        return components;
+    }
+
+    std::vector<Variant> EntityContainer::get_components(EntityID id) const {
+        auto & ent = get_entity(id);
+        auto & archetype = _archetypes.at(ent.archetype_id());
+
+        std::vector<Variant> components;
+        components.reserve(archetype.column_count());
+        for (size_t col = 0; col < archetype.column_count(); col++) {
+            components.emplace_back(archetype.at(col, ent.row()));
+        }
+        return components;
     }
 
     void EntityContainer::clear() {
-        _entities.clear();
-        _pos = 0;
+        _archetypes.clear();
+        _name_index.clear();
+
+        // slots are kept so that IDs from before clearing stay stale,
+        // the free queue is rebuilt in index order
+        _free_head = NO_FREE_SLOT;
+        _free_tail = NO_FREE_SLOT;
+        _free_count = 0;
+        for (size_t i = 0; i < _slots.size(); i++) {
+            auto index = static_cast<EntityIndex>(i);
+            auto & slot = _slots[index];
+            if (slot.entity) {
+                slot.entity = std::nullopt;
+                slot.generation = next_entity_generation(slot.generation);
+            }
+            if (slot.generation != RETIRED_ENTITY_GENERATION) _push_free_slot(index);
+        }
+        _live_ids.clear();
     }
 }
@@ -0,0 +1,53 @@
+#include <smen/ecs/entity_sparse_set.hpp>
+
+namespace smen {
+    EntitySparseSet::EntitySparseSet()
+    : _dense()
+    , _sparse()
+    {}
+
+    bool EntitySparseSet::contains(EntityID id) const {
+        auto index = entity_index(id);
+        if (index >= _sparse.size() || _sparse[index] == NOT_PRESENT) return false;
+
+        // the slot may be occupied by a different generation of the entity
+        return _dense[_sparse[index]] == id;
+    }
+
+    bool EntitySparseSet::insert(EntityID id) {
+        auto index = entity_index(id);
+        if (index < _sparse.size() && _sparse[index] != NOT_PRESENT) {
+            auto pos = _sparse[index];
+            if (_dense[pos] == id) return false;
+
+            // stale generation of the same slot, replace it in place
+            _dense[pos] = id;
+            return true;
+        }
+
+        if (index >= _sparse.size()) _sparse.resize(index + 1, size_t(NOT_PRESENT));
+        _sparse[index] = _dense.size();
+        _dense.emplace_back(id);
+        return true;
+    }
+
+    bool EntitySparseSet::erase(EntityID id) {
+        if (!contains(id)) return false;
+
+        auto index = entity_index(id);
+        auto pos = _sparse[index];
+        auto last_id = _dense.back();
+
+        _dense[pos] = last_id;
+        _sparse[entity_index(last_id)] = pos;
+
+        _dense.pop_back();
+        _sparse[index] = NOT_PRESENT;
+        return true;
+    }
+
+    void EntitySparseSet::clear() {
+        _dense.clear();
+        _sparse.clear();
+    }
+}
@@ -0,0 +1,177 @@
+#include <smen/ecs/hierarchy.hpp>
+#include <string>
+
+namespace smen {
+    SceneHierarchy::SceneHierarchy()
+    : _nodes()
+    {}
+
+    const SceneHierarchyNode * SceneHierarchy::_find(EntityID id) const {
+        auto index = entity_index(id);
+        if (index >= _nodes.size()) return nullptr;
+
+        // also rejects nodes that belong to another generation of the slot
+        auto & node = _nodes[index];
+        if (node.id != id) return nullptr;
+        return &node;
+    }
+
+    SceneHierarchyNode & SceneHierarchy::_get_or_create(EntityID id) {
+        auto index = entity_index(id);
+        if (index >= _nodes.size()) _nodes.resize(index + 1, SceneHierarchyNode());
+
+        auto & node = _nodes[index];
+        if (node.id != id) {
+            node = SceneHierarchyNode();
+            node.id = id;
+        }
+        return node;
+    }
+
+    SceneHierarchyNode & SceneHierarchy::_at(EntityID id) {
+        return _nodes[entity_index(id)];
+    }
+
+    void SceneHierarchy::_unlink(SceneHierarchyNode & node) {
+        if (node.parent == 0) return;
+
+        auto & parent = _at(node.parent);
+        if (node.prev_sibling != 0) _at(node.prev_sibling).next_sibling = node.next_sibling;
+        else parent.first_child = node.next_sibling;
+
+        if (node.next_sibling != 0) _at(node.next_sibling).prev_sibling = node.prev_sibling;
+        else parent.last_child = node.prev_sibling;
+
+        node.parent = 0;
+        node.prev_sibling = 0;
+        node.next_sibling = 0;
+
+        _release_if_unlinked(parent);
+    }
+
+    void SceneHierarchy::_release_if_unlinked(SceneHierarchyNode & node) {
+        if (node.parent == 0 && node.first_child == 0) node = SceneHierarchyNode();
+    }
+
+    EntityID SceneHierarchy::parent_of(EntityID id) const {
+        auto * node = _find(id);
+        if (node == nullptr) return 0;
+        return node->parent;
+    }
+
+    EntityID SceneHierarchy::first_child_of(EntityID id) const {
+        auto * node = _find(id);
+        if (node == nullptr) return 0;
+        return node->first_child;
+    }
+
+    EntityID SceneHierarchy::next_sibling_of(EntityID id) const {
+        auto * node = _find(id);
+        if (node == nullptr) return 0;
+        return node->next_sibling;
+    }
+
+    bool SceneHierarchy::has_children(EntityID id) const {
+        return first_child_of(id) != 0;
+    }
+
+    bool SceneHierarchy::has_parent(EntityID id) const {
+        return parent_of(id) != 0;
+    }
+
+    bool SceneHierarchy::is_ancestor_of(EntityID ancestor_id, EntityID id) const {
+        for (auto cur = parent_of(id); cur != 0; cur = parent_of(cur)) {
+            if (cur == ancestor_id) return true;
+        }
+        return false;
+    }
+
+    std::vector<EntityID> SceneHierarchy::children_of(EntityID id) const {
+        auto children = std::vector<EntityID>();
+        for (auto child = first_child_of(id); child != 0; child = next_sibling_of(child)) {
+            children.emplace_back(child);
+        }
+        return children;
+    }
+
+    void SceneHierarchy::attach(EntityID parent_id, EntityID child_id) {
+        if (parent_id == child_id || is_ancestor_of(child_id, parent_id)) {
+            throw SceneHierarchyException("entity with ID " + std::to_string(child_id) + " can't be made a child of its own descendant " + std::to_string(parent_id));
+        }
+
+        // both nodes must exist before taking references,
+        // as creating one may grow the node array
+        _get_or_create(parent_id);
+        auto & child = _get_or_create(child_id);
+        _unlink(child);
+
+        // unlinking may have released the parent node if the
+        // child was its only child, so it has to be looked up again
+        auto & parent = _get_or_create(parent_id);
+        child.parent = parent_id;
+        child.prev_sibling = parent.last_child;
+        if (parent.last_child != 0) _at(parent.last_child).next_sibling = child_id;
+        else parent.first_child = child_id;
+        parent.last_child = child_id;
+    }
+
+    void SceneHierarchy::detach(EntityID child_id) {
+        if (_find(child_id) == nullptr) return;
+
+        auto & child = _at(child_id);
+        _unlink(child);
+        _release_if_unlinked(child);
+    }
+
+    void SceneHierarchy::remove(EntityID id) {
+        if (_find(id) == nullptr) return;
+
+        auto & node = _at(id);
+        _unlink(node);
+
+        auto child_id = node.first_child;
+        while (child_id != 0) {
+            auto & child = _at(child_id);
+            auto next_id = child.next_sibling;
+
+            child.parent = 0;
+            child.prev_sibling = 0;
+            child.next_sibling = 0;
+            _release_if_unlinked(child);
+
+            child_id = next_id;
+        }
+
+        node = SceneHierarchyNode();
+    }
+
+    std::vector<SceneHierarchyEntry> SceneHierarchy::depth_order(EntityID root_id) const {
+        auto entries = std::vector<SceneHierarchyEntry>();
+
+        auto current = root_id;
+        unsigned int depth = 0;
+        while (true) {
+            entries.emplace_back(SceneHierarchyEntry { .id = current, .depth = depth });
+
+            auto child = first_child_of(current);
+            if (child != 0) {
+                current = child;
+                depth += 1;
+                continue;
+            }
+
+            while (current != root_id && next_sibling_of(current) == 0) {
+                current = parent_of(current);
+                depth -= 1;
+            }
+            if (current == root_id) break;
+            current = next_sibling_of(current);
+        }
+
+        return entries;
+    }
+
+    void SceneHierarchy::clear() {
+        _nodes.clear();
+    }
+}
@@ -0,0 +1,109 @@
+#include <smen/ecs/prefab.hpp>
+#include <smen/ecs/scene.hpp>
+#include <unordered_map>
+
+namespace smen {
+    Prefab::Prefab()
+    : _nodes()
+    {}
+
+    Prefab Prefab::capture(const Scene & scene, EntityID root_id) {
+        if (!scene.is_valid_entity_id(root_id)) {
+            throw PrefabException("attempted to capture entity with ID " + std::to_string(root_id) + ", but it doesn't exist");
+        }
+
+        auto prefab = Prefab();
+        auto & hierarchy = scene.hierarchy();
+
+        // breadth first, so that parents are captured before their children
+        // node i is captured from ids[i]
+        auto ids = std::vector<EntityID>{ root_id };
+        auto parents = std::vector<size_t>{ PrefabNode::NO_PARENT };
+        for (size_t i = 0; i < ids.size(); i++) {
+            auto id = ids[i];
+
+            auto node = PrefabNode {
+                .name = scene.name_of(id),
+                .parent = parents[i],
+                .components = {}
+            };
+
+            auto components = scene.get_components(id);
+            node.components.reserve(components.size());
+            for (auto & component : components) {
+                node.components.emplace_back(component.clone());
+            }
+            prefab._nodes.emplace_back(std::move(node));
+
+            for (auto child = hierarchy.first_child_of(id); child != 0; child = hierarchy.next_sibling_of(child)) {
+                ids.emplace_back(child);
+                parents.emplace_back(i);
+            }
+        }
+
+        return prefab;
+    }
+
+    EntityID Prefab::instantiate(Scene & scene) const {
+        return instantiate(scene, 1).front();
+    }
+
+    std::vector<EntityID> Prefab::instantiate(Scene & scene, size_t count) const {
+        if (_nodes.empty()) throw PrefabException("attempted to instantiate an empty prefab");
+
+        SceneDeferScopeGuard guard(scene);
+        auto & entities = scene.entity_container();
+        auto & variants = scene.variant_container();
+
+        // every instance of a node ends up in the same archetype, so it's
+        // looked up once and its rows and component pages are reserved
+        // for all instances up front
+        auto archetype_ids = std::vector<ArchetypeID>();
+        archetype_ids.reserve(_nodes.size());
+        auto type_counts = std::unordered_map<VariantTypeID, size_t>();
+        auto archetype_counts = std::unordered_map<ArchetypeID, size_t>();
+        for (auto & node : _nodes) {
+            auto signature = ArchetypeSignature();
+            signature.reserve(node.components.size());
+            for (auto & component : node.components) {
+                signature.emplace_back(component.type_id());
+                type_counts[component.type_id()] += count;
+            }
+
+            auto archetype_id = entities.archetype_with(std::move(signature));
+            archetype_ids.emplace_back(archetype_id);
+            archetype_counts[archetype_id] += count;
+        }
+
+        for (auto & [type_id, type_count] : type_counts) {
+            variants.reserve(type_id, type_count);
+        }
+        for (auto & [archetype_id, archetype_count] : archetype_counts) {
+            entities.reserve(archetype_id, archetype_count);
+        }
+
+        auto root_ids = std::vector<EntityID>();
+        root_ids.reserve(count);
+        auto ids = std::vector<EntityID>(_nodes.size());
+        for (size_t i = 0; i < count; i++) {
+            for (size_t n = 0; n < _nodes.size(); n++) {
+                auto & node = _nodes[n];
+
+                // clones of components without ctors or dtors are plain
+                // copies of the captured bytes into the reserved pages
+                auto components = std::vector<Variant>();
+                components.reserve(node.components.size());
+                for (auto & component : node.components) {
+                    components.emplace_back(component.clone());
+                }
+
+                ids[n] = scene._spawn_into(node.name, archetype_ids[n], std::move(components));
+                if (node.parent != PrefabNode::NO_PARENT) {
+                    scene.adopt_child(ids[node.parent], ids[n]);
+                }
+            }
+            root_ids.emplace_back(ids.front());
+        }
+        return root_ids;
+    }
+}
@@ -3,25 +3,31 @@
 #include <smen/ecs/system.hpp>
 #include <smen/lua/native_types.hpp>
 #include <algorithm>
+#include <cassert>
 
 namespace smen {
     SceneIterator::SceneIterator(const EntityContainer & container)
-    : _container(container)
-    , _cur(1)
+    : SceneIterator(container, 0)
     {}
 
-    SceneIterator::SceneIterator(const EntityContainer & container, EntityID cur)
+    SceneIterator::SceneIterator(const EntityContainer & container, size_t pos)
     : _container(container)
-    , _cur(cur)
-    {}
-
-    SceneIterator & SceneIterator::operator++() {
-        _cur += 1;
+    , _pos(pos)
+    , _current_id(0)
+    {
+        _current_id = _id_at_pos();
+    }
 
-        while (_cur <= _container.max_entity_id() && !_container.has_entity(_cur)) {
-            _cur += 1;
-        }
+    EntityID SceneIterator::_id_at_pos() const {
+        if (at_end()) return 0;
+        return _container.live_ids()[_pos];
+    }
 
+    SceneIterator & SceneIterator::operator++() {
+        // if the current entity was killed, the last one was swapped
+        // into its place and hasn't been visited yet
+        if (_id_at_pos() == _current_id) _pos += 1;
+        _current_id = _id_at_pos();
         return *this;
     }
 
@@ -30,7 +36,14 @@ namespace smen {
         return *this;
     }
 
-    const std::vector<EntityID> Scene::_empty_id_vec = std::vector<EntityID>();
+    SceneDeferScopeGuard::SceneDeferScopeGuard(Scene & scene)
+    : scene(scene) {
+        scene._begin_deferring();
+    }
+
+    SceneDeferScopeGuard::~SceneDeferScopeGuard() {
+        scene._end_deferring();
+    }
 
     Scene::Scene(const std::string & name, VariantTypeDirectory & variant_type_dir)
     : logger(make_logger("Scene " + name))
@@ -43,8 +56,14 @@ namespace smen {
     , _ev()
     , _enabled(true)
     , _total_entity_count(0)
-    , _child_map()
-    , _parent_map()
+    , _defer_depth(0)
+    , _deferred_events()
+    , _scheduler()
+    , _thread_pool()
+    , _commands()
+    , _worker_commands()
+    , _script_map()
+    , _hierarchy()
     , _name(name)
     {
         _ev.add(_lua_smen_lib.post_load, [&](LuaVariantLibrary & variant_lib, LuaEngine & engine) {
@@ -54,19 +73,113 @@ namespace smen {
         _lua_smen_lib.init_preloader();
     }
 
+    bool SceneEventBatch::empty() const {
+        return added_entities.empty() && added_components.empty() && removed_components.empty() && removed_entities.empty();
+    }
+
+    void SceneEventBatch::clear() {
+        added_entities.clear();
+        added_components.clear();
+        removed_components.clear();
+        removed_entities.clear();
+    }
+
+    void Scene::_emit(SceneEventType type, EntityID entity_id, Variant * component) {
+        if (_defer_depth > 0) {
+            switch(type) {
+            case SceneEventType::ENTITY_ADDED:
+                _deferred_events.added_entities.emplace_back(entity_id);
+                break;
+            case SceneEventType::COMPONENT_ADDED:
+                _deferred_events.added_components.emplace_back(entity_id, *component);
+                break;
+            case SceneEventType::COMPONENT_REMOVED:
+                _deferred_events.removed_components.emplace_back(entity_id, *component);
+                break;
+            case SceneEventType::ENTITY_REMOVED:
+                _deferred_events.removed_entities.emplace_back(entity_id);
+                break;
+            }
+            return;
+        }
+
+        switch(type) {
+        case SceneEventType::ENTITY_ADDED:
+            entity_added(*this, std::span<const EntityID>(&entity_id, 1));
+            break;
+        case SceneEventType::COMPONENT_ADDED: {
+            auto change = ComponentChange { .entity_id = entity_id, .component = *component };
+            component_added(*this, std::span<const ComponentChange>(&change, 1));
+            break;
+        }
+        case SceneEventType::COMPONENT_REMOVED: {
+            auto change = ComponentChange { .entity_id = entity_id, .component = *component };
+            component_removed(*this, std::span<const ComponentChange>(&change, 1));
+            break;
+        }
+        case SceneEventType::ENTITY_REMOVED:
+            entity_removed(*this, std::span<const EntityID>(&entity_id, 1));
+            break;
+        }
+    }
+
+    void Scene::_fire(const SceneEventBatch & batch) {
+        if (!batch.added_entities.empty()) entity_added(*this, batch.added_entities);
+        if (!batch.added_components.empty()) component_added(*this, batch.added_components);
+        if (!batch.removed_components.empty()) component_removed(*this, batch.removed_components);
+        if (!batch.removed_entities.empty()) entity_removed(*this, batch.removed_entities);
+    }
+
+    void Scene::_begin_deferring() {
+        _defer_depth += 1;
+    }
+
+    void Scene::_end_deferring() {
+        _defer_depth -= 1;
+        if (_defer_depth > 0) return;
+
+        // listeners may cause more structural changes,
+        // which are fired immediately as we're no longer deferring
+        if (_deferred_events.empty()) return;
+
+        auto batch = std::move(_deferred_events);
+        _deferred_events.clear();
+        _fire(batch);
+    }
+
+    // nothing guards the scene against concurrent changes, so systems
+    // running as pool tasks have to go through Scene::commands instead
+    // this includes tasks the main thread runs while it waits on the pool
+    static void assert_not_on_worker() {
+        assert(!ThreadPool::running_task() && "scene modified from a thread pool task, use Scene::commands instead");
+    }
+
     EntityID Scene::spawn(const std::string & name) {
+        assert_not_on_worker();
         auto new_id = _entity_container.add_entity(name);
-        entity_added(*this, new_id);
+        _emit(SceneEventType::ENTITY_ADDED, new_id);
+        _total_entity_count += 1;
+        return new_id;
+    }
+
+    EntityID Scene::_spawn_into(const std::string & name, ArchetypeID archetype_id, std::vector<Variant> && components) {
+        assert_not_on_worker();
+        auto added = components;
+        auto new_id = _entity_container.add_entity(name, archetype_id, std::move(components));
+        _emit(SceneEventType::ENTITY_ADDED, new_id);
+        for (auto & component : added) {
+            _emit(SceneEventType::COMPONENT_ADDED, new_id, &component);
+        }
         _total_entity_count += 1;
         return new_id;
     }
 
-    bool Scene::is_valid_entity_id(EntityID id) {
-        return _entity_container.is_valid_entity_slot(id) && _entity_container.has_entity(id);
+    bool Scene::is_valid_entity_id(EntityID id) const {
+        return id != 0 && _entity_container.has_entity(id);
     }
 
     Variant Scene::add_component(EntityID id, const std::string & name) {
-        auto & ent = _entity_container.get_entity(id);
+        assert_not_on_worker();
         auto & type = _variant_container.dir.resolve(name);
 
         if (!type.valid()) {
@@ -77,20 +190,20 @@ namespace smen {
             throw std::runtime_error("type '" + name + "' is not a component type");
         }
         auto variant = Variant::create(_variant_container, type.id);
-        ent.add_component(variant);
-        component_added(*this, id, variant);
+        _entity_container.add_component(id, variant);
+        _emit(SceneEventType::COMPONENT_ADDED, id, &variant);
         return variant;
     }
 
     void Scene::add_component(EntityID id, Variant & variant) {
-        auto & ent = _entity_container.get_entity(id);
-        ent.add_component(variant);
-        component_added(*this, id, variant);
+        assert_not_on_worker();
+        if (_entity_container.add_component(id, variant)) {
+            _emit(SceneEventType::COMPONENT_ADDED, id, &variant);
+        }
     }
 
     bool Scene::has_component(EntityID id, VariantTypeID type_id) const {
-        auto & ent = _entity_container.get_entity(id);
-        return ent.has_component(type_id);
+        return _entity_container.has_component(id, type_id);
     }
 
     bool Scene::has_component(EntityID id, const std::string & name) const {
@@ -99,12 +212,19 @@ namespace smen {
 
 
     std::vector<EntityID> Scene::entities_with_component(VariantTypeID type_id) const {
+        auto & archetypes = _entity_container.archetypes();
+        auto & archetype_ids = archetypes.archetypes_with(type_id);
+
+        size_t count = 0;
+        for (auto archetype_id : archetype_ids) {
+            count += archetypes.at(archetype_id).size();
+        }
+
         auto vec = std::vector<EntityID>();
-        for (auto & ent_id : *this) {
-            auto comp = get_component(ent_id, type_id);
-            if (comp) {
-                vec.emplace_back(ent_id);
-            }
+        vec.reserve(count);
+        for (auto archetype_id : archetype_ids) {
+            auto & entities = archetypes.at(archetype_id).entities();
+            vec.insert(vec.end(), entities.begin(), entities.end());
         }
         return vec;
     }
@@ -118,8 +238,7 @@ namespace smen {
     }
 
     std::optional<Variant> Scene::get_component(EntityID id, VariantTypeID type_id) const {
-        auto & ent = _entity_container.get_entity(id);
-        return ent.get_component(type_id);
+        return _entity_container.get_component(id, type_id);
     }
 
     std::optional<Variant> Scene::get_component(EntityID id, const std::string & name) const {
@@ -131,8 +250,7 @@ namespace smen {
     }
 
     std::vector<Variant> Scene::get_components(EntityID id, VariantTypeID type_id) const {
-        auto & ent = _entity_container.get_entity(id);
-        return ent.get_components(type_id);
+        return _entity_container.get_components(id, type_id);
     }
 
     std::vector<Variant> Scene::get_components(EntityID id, const std::string & name) const {
@@ -144,72 +262,51 @@ namespace smen {
     }
     
     std::vector<Variant> Scene::get_components(EntityID id) const {
-        auto vec = std::vector<Variant>();
-        for (auto & comp : _entity_container.get_entity(id).all_components()) {
-            vec.emplace_back(comp);
-        }
-        return vec;
+        return _entity_container.get_components(id);
     }
 
     bool Scene::remove_component(EntityID id, Variant & variant) {
-        auto & ent = _entity_container.get_entity(id);
-        if (ent.remove_component(variant)) {
-            component_removed(*this, id, variant);
+        assert_not_on_worker();
+        if (_entity_container.remove_component(id, variant)) {
+            _emit(SceneEventType::COMPONENT_REMOVED, id, &variant);
             return true;
         }
         return false;
     }
 
-    const std::vector<EntityID> & Scene::children_of(EntityID id) const {
-        auto it = _child_map.find(id);
-        if (it == _child_map.end()) return _empty_id_vec;
-        return it->second;
+    std::vector<EntityID> Scene::children_of(EntityID id) const {
+        return _hierarchy.children_of(id);
     }
 
     bool Scene::has_children(EntityID id) const {
-        return _child_map.contains(id);
+        return _hierarchy.has_children(id);
     }
 
     std::optional<EntityID> Scene::parent_of(EntityID id) const {
-        auto it = _parent_map.find(id);
-        if (it == _parent_map.end()) return std::nullopt;
-        return it->second;
+        auto parent_id = _hierarchy.parent_of(id);
+        if (parent_id == 0) return std::nullopt;
+        return parent_id;
     }
 
     bool Scene::is_child_of(EntityID parent_id, EntityID child_id) const {
-        auto it = _parent_map.find(child_id);
-        if (it == _parent_map.end()) return false;
-        return it->second == parent_id;
+        return _hierarchy.has_parent(child_id) && _hierarchy.parent_of(child_id) == parent_id;
     }
 
     bool Scene::has_parent(EntityID child_id) const {
-        return _parent_map.contains(child_id);
+        return _hierarchy.has_parent(child_id);
     }
 
     void Scene::adopt_child(EntityID parent_id, EntityID child_id) {
-        auto parent_it = _parent_map.find(child_id);
-        if (parent_it != _parent_map.end()) {
-            // child already has a parent
-            // we need to remove it from its parent's list of children
-
-            auto prev_parent_id = parent_it->second;
-
-            auto prev_parent_children_it = _child_map.find(prev_parent_id);
-
-            if (prev_parent_children_it != _child_map.end()) {
-                std::erase(prev_parent_children_it->second, child_id);
-            }
+        assert_not_on_worker();
+        if (!is_valid_entity_id(parent_id) || !is_valid_entity_id(child_id)) {
+            throw SceneException("attempted to make entity with ID " + std::to_string(child_id) + " a child of entity with ID " + std::to_string(parent_id) + ", but one of them doesn't exist");
         }
 
-        _parent_map[child_id] = parent_id;
-
-        auto child_vec_it = _child_map.find(parent_id);
-        if (child_vec_it == _child_map.end()) {
-            _child_map.emplace(parent_id, std::vector<EntityID>{ child_id });
-            return;
+        try {
+            _hierarchy.attach(parent_id, child_id);
+        } catch (const SceneHierarchyException & e) {
+            throw SceneException(e.what());
         }
-
-        child_vec_it->second.emplace_back(child_id);
     }
 
     EntityID Scene::spawn_child(EntityID parent_id, const std::string & name) {
@@ -219,30 +316,16 @@ namespace smen {
     }
 
     void Scene::make_orphan(EntityID id) {
-        auto parent_it = _parent_map.find(id);
-        if (parent_it != _parent_map.end()) {
-            // see adopt_child
-            
-            auto prev_parent_id = parent_it->second;
-
-            auto prev_parent_children_it = _child_map.find(prev_parent_id);
-            if (prev_parent_children_it != _child_map.end()) {
-                std::erase(prev_parent_children_it->second, id);
-            }
-        }
-
-        _parent_map.erase(id);
+        assert_not_on_worker();
+        _hierarchy.detach(id);
     }
 
     bool Scene::remove_component(EntityID id, VariantTypeID type_id) {
-        auto & ent = _entity_container.get_entity(id);
-        auto maybe_variant = ent.get_component(type_id);
+        assert_not_on_worker();
+        auto maybe_variant = _entity_container.remove_component(id, type_id);
         if (!maybe_variant) return false;
-        if (ent.remove_component(*maybe_variant)) {
-            component_removed(*this, id, *maybe_variant);
-            return true;
-        }
-        return false;
+        _emit(SceneEventType::COMPONENT_REMOVED, id, &*maybe_variant);
+        return true;
     }
 
     bool Scene::remove_component(EntityID id, const std::string & name) {
@@ -250,21 +333,13 @@ namespace smen {
     }
 
     std::vector<EntityID> Scene::find_by_name(const std::string & name) const {
-        auto ents = std::vector<EntityID>();
-        for (auto ent_id : *this) {
-            if (name_of(ent_id) == name) {
-                ents.emplace_back(ent_id);
-            }
-        }
-        return ents;
+        return _entity_container.entities_named(name);
     }
 
     EntityID Scene::find_first_by_name(const std::string & name) const {
-        for (auto ent_id : *this) {
-            if (name_of(ent_id) == name) return ent_id;
-        }
-
-        return 0;
+        auto & ids = _entity_container.entities_named(name);
+        if (ids.empty()) return 0;
+        return ids.front();
     }
 
     const std::string & Scene::name_of(EntityID id) const {
@@ -273,24 +348,46 @@ namespace smen {
     }
 
     void Scene::set_name(EntityID id, const std::string & name) {
-        auto & ent = _entity_container.get_entity(id);
-        ent.set_name(name);
+        assert_not_on_worker();
+        _entity_container.set_name(id, name);
     }
 
     bool Scene::system_query_matches(EntityID id, const SystemQuery & query) const {
-        for (auto & type_id : query.required_type_ids()) {
-            if (!has_component(id, type_id)) return false;
-        }
-        return true;
+        // events are deferred, so handlers may ask about entities
+        // that were killed earlier in the same tick
+        if (!is_valid_entity_id(id)) return false;
+        return query.matches(_entity_container.archetype_of(id).mask());
     }
 
     void Scene::kill(EntityID id) {
+        assert_not_on_worker();
         if (_entity_container.remove_entity(id)) {
             _total_entity_count -= 1;
-            entity_removed(*this, id);
+            _hierarchy.remove(id);
+            _emit(SceneEventType::ENTITY_REMOVED, id);
         }
     }
 
+    size_t Scene::kill_recursive(EntityID id) {
+        assert_not_on_worker();
+        if (!is_valid_entity_id(id)) return 0;
+
+        // the subtree is collected up front, as killing an
+        // entity unlinks it from the hierarchy
+        auto subtree = std::vector<EntityID>{ id };
+        for (size_t i = 0; i < subtree.size(); i++) {
+            for (auto child = _hierarchy.first_child_of(subtree[i]); child != 0; child = _hierarchy.next_sibling_of(child)) {
+                subtree.emplace_back(child);
+            }
+        }
+
+        SceneDeferScopeGuard guard(*this);
+        for (auto it = subtree.rbegin(); it != subtree.rend(); ++it) {
+            kill(*it);
+        }
+        return subtree.size();
+    }
+
     void Scene::new_script(const std::string & id) {
         if (_script_map.contains(id)) throw SceneException("script with '" + id + "' already exists, use relink_script to change its path");
         _script_map.emplace(id, LuaScript(_lua_engine));
@@ -342,18 +439,18 @@ namespace smen {
     }
 
     SceneIterator Scene::begin() const {
-        return SceneIterator(_entity_container, 1);
+        return SceneIterator(_entity_container, 0);
     }
 
     SceneIterator Scene::end() const {
-        return SceneIterator(_entity_container, _entity_container.max_entity_id() + 1);
+        return SceneIterator(_entity_container, _entity_container.size());
     }
 
     SystemQuery Scene::system_query() {
         return SystemQuery(*_dir);
     }
 
-    void Scene::_debug_hierarchy(std::ostream & s, unsigned int indent, EntityID id) {
+    void Scene::_debug_hierarchy_entry(std::ostream & s, unsigned int indent, EntityID id) {
         if (indent >= 1) {
             for (unsigned int i = 0; i < indent - 1; i++) {
                 s << "   ";
@@ -362,30 +459,95 @@ namespace smen {
         }
         auto parent_id = parent_of(id);
         s << name_of(id) << " (" << (parent_id ? name_of(*parent_id) : "root") << ")" << "\n";;
-        auto & children = children_of(id);
-        for (auto & child : children) {
-            _debug_hierarchy(s, indent + 1, child);
-        }
     }
 
     void Scene::clear() {
+        assert_not_on_worker();
         _system_container.clear();
         _entity_container.clear();
         _total_entity_count = 0;
+        _deferred_events.clear();
+        _commands.clear();
+        for (auto & commands : _worker_commands) {
+            commands.clear();
+        }
         _script_map.clear();
+        _hierarchy.clear();
     }
 
     void Scene::debug_hierarchy(std::ostream & s, EntityID id) {
-        _debug_hierarchy(s, 0, id);
+        for (auto & entry : _hierarchy.depth_order(id)) {
+            _debug_hierarchy_entry(s, entry.depth, entry.id);
+        }
+    }
+
+    ThreadPool & Scene::thread_pool() {
+        // threads are only started once a scene actually
+        // has systems that can make use of them
+        if (!_thread_pool) {
+            _thread_pool = std::make_unique<ThreadPool>();
+            _worker_commands.resize(_thread_pool->thread_count());
+        }
+        return *_thread_pool;
+    }
+
+    EntityCommandBuffer & Scene::commands() {
+        if (!_thread_pool) return _commands;
+
+        // the main thread gets the scene's own buffer, also when it's
+        // running tasks while waiting on the pool
+        auto worker_index = _thread_pool->current_worker_index();
+        if (worker_index == ThreadPool::NOT_A_WORKER) return _commands;
+        return _worker_commands.at(worker_index);
+    }
+
+    void Scene::_play_back_commands() {
+        for (auto & commands : _worker_commands) {
+            if (!commands.empty()) commands.playback(*this);
+        }
+        if (!_commands.empty()) _commands.playback(*this);
+    }
+
+    void Scene::_process_systems(double delta) {
+        // rebuilding the schedule is cheap compared to running the systems,
+        // and it picks up systems that were added, enabled or disabled
+        _scheduler.build(_system_container.ordered_systems(), *this);
+
+        for (auto & stage : _scheduler.stages()) {
+            if (stage.parallel) {
+                auto & pool = thread_pool();
+                for (auto * system : stage.systems) {
+                    pool.submit([this, system, delta]() {
+                        system->run_process(*this, delta);
+                    });
+                }
+                pool.wait();
+            } else {
+                for (auto * system : stage.systems) {
+                    system->run_process(*this, delta);
+                }
+            }
+
+            _play_back_commands();
+        }
     }
 
     void Scene::process(double delta) {
         if (!_enabled) return;
+        SceneDeferScopeGuard scope(*this);
         on_process(*this, delta);
+        _process_systems(delta);
     }
 
     void Scene::render() {
         if (!_enabled) return;
+        SceneDeferScopeGuard scope(*this);
         on_render(*this);
+
+        // rendering always happens on the main thread
+        for (auto * system : _system_container.ordered_systems()) {
+            if (system->initialized_in(*this)) system->run_render(*this);
+        }
+        _play_back_commands();
     }
 }
@@ -1,68 +1,148 @@
 #include <smen/ecs/system.hpp>
 #include <smen/ecs/scene.hpp>
+#include <algorithm>
 
 namespace smen {
     System::System(const SystemContainer & container, const std::string & name, const SystemQuery & query)
     : _query(query)
     , _matching_entities()
+    , _reads()
+    , _writes()
+    , _declares_access(false)
+    , _parallel_chunk_size(0)
     , _ev()
     , _container(container)
+    , _scene(nullptr)
     , name(name)
     , enabled(true)
     , logger(make_logger("System " + name))
     {}
 
-    void System::initialize_events_in(Scene & scene) {
-        _ev.add(scene.entity_added, [&](const Scene & scene, EntityID entity_id) {
-            if (scene.system_query_matches(entity_id, _query)) {
-                _matching_entities.emplace_back(entity_id);
-            }
-        });
+    void System::_update_membership(const Scene & scene, EntityID entity_id) {
+        if (scene.is_valid_entity_id(entity_id) && scene.system_query_matches(entity_id, _query)) {
+            _matching_entities.insert(entity_id);
+        } else {
+            _matching_entities.erase(entity_id);
+        }
+    }
 
-        _ev.add(scene.component_added, [&](const Scene & scene, EntityID entity_id, Variant & component) {
-            if (scene.system_query_matches(entity_id, _query) && std::find(_matching_entities.begin(), _matching_entities.end(), entity_id) == _matching_entities.end()) {
-                _matching_entities.emplace_back(entity_id);
-            }
-        });
+    System & System::reads(VariantTypeID type_id) {
+        _reads.set(type_id);
+        _declares_access = true;
+        return *this;
+    }
+
+    System & System::writes(VariantTypeID type_id) {
+        _writes.set(type_id);
+        _declares_access = true;
+        return *this;
+    }
 
-        _ev.add(scene.component_removed, [&](const Scene & scene, EntityID entity_id, Variant & component) {
-            std::erase(_matching_entities, entity_id);
+    System & System::parallelize(size_t chunk_size) {
+        _parallel_chunk_size = chunk_size;
+        return *this;
+    }
+
+    bool System::main_thread_only() const {
+        // nothing is known about what undeclared systems touch
+        if (!_declares_access) return true;
+        return process && _container.is_process_pinned_to_main_thread(process);
+    }
+
+    bool System::conflicts_with(const System & other) const {
+        if (main_thread_only() || other.main_thread_only()) return true;
+
+        return _writes.intersects(other._writes)
+            || _writes.intersects(other._reads)
+            || _reads.intersects(other._writes);
+    }
+
+    void System::initialize_events_in(Scene & scene) {
+        _scene = &scene;
+
+        // every structural event just re-evaluates the membership of the
+        // entities it touches, which makes the result independent of
+        // the order in which batched events are delivered (e.g. when an
+        // ID freed by a kill is reused by a spawn in the same batch)
+        _ev.add(scene.entity_added, [&](const Scene & scene, std::span<const EntityID> ids) {
+            for (auto & ent_id : ids) _update_membership(scene, ent_id);
         });
 
-        _ev.add(scene.entity_removed, [&](const Scene & scene, EntityID entity_id) {
-            std::erase(_matching_entities, entity_id);
+        _ev.add(scene.component_added, [&](const Scene & scene, std::span<const ComponentChange> changes) {
+            for (auto & change : changes) _update_membership(scene, change.entity_id);
         });
 
-        _ev.add(scene.on_process, [&](Scene & scene, double delta) {
-            if (!enabled) return;
-            if (process && _matching_entities.size() > 0) {
-                auto entities_copy = _matching_entities;
-                for (auto & ent_id : entities_copy) {
-                    _container.process_db[process](scene, ent_id, delta);
-                }
-            }
+        _ev.add(scene.component_removed, [&](const Scene & scene, std::span<const ComponentChange> changes) {
+            for (auto & change : changes) _update_membership(scene, change.entity_id);
         });
 
-        _ev.add(scene.on_render, [&](Scene & scene) {
-            if (!enabled) return;
-            if (render && _matching_entities.size() > 0) {
-                auto entities_copy = _matching_entities;
-                for (auto & ent_id : entities_copy) {
-                    _container.render_db[render](scene, ent_id);
-                }
-            }
+        _ev.add(scene.entity_removed, [&](const Scene & scene, std::span<const EntityID> ids) {
+            for (auto & ent_id : ids) _update_membership(scene, ent_id);
         });
 
         for (auto & ent_id : scene) {
             if (scene.system_query_matches(ent_id, _query)) {
-                _matching_entities.emplace_back(ent_id);
+                _matching_entities.insert(ent_id);
             }
         }
     }
 
+    void System::_process_range(Scene & scene, size_t begin, size_t end, double delta) {
+        auto & ids = _matching_entities.dense();
+
+        // the scene defers membership changes until the end of the
+        // tick, so entities killed or changed by earlier calls are
+        // still in the set and have to be skipped here
+        for (auto i = begin; i < end; i++) {
+            auto ent_id = ids[i];
+            if (!scene.is_valid_entity_id(ent_id) || !scene.system_query_matches(ent_id, _query)) continue;
+            _container.process_db[process](scene, ent_id, delta);
+        }
+    }
+
+    void System::run_process(Scene & scene, double delta) {
+        if (!enabled) return;
+        if (!process || _matching_entities.size() == 0) return;
+
+        auto count = _matching_entities.size();
+        auto chunk_size = _parallel_chunk_size;
+        // pinned (e.g. Lua) process functions can't be called from workers,
+        // so those systems fall back to processing every entity serially
+        if (main_thread_only() || chunk_size == 0 || count <= chunk_size) {
+            _process_range(scene, 0, count, delta);
+            return;
+        }
+
+        // structural changes made by the chunks go to the per-thread
+        // command buffers of the scene and are applied after the stage
+        auto & pool = scene.thread_pool();
+        auto group = ThreadPoolTaskGroup();
+        for (size_t begin = 0; begin < count; begin += chunk_size) {
+            auto end = std::min(begin + chunk_size, count);
+            pool.submit(group, [this, &scene, begin, end, delta]() {
+                _process_range(scene, begin, end, delta);
+            });
+        }
+        pool.wait(group);
+    }
+
+    void System::run_render(Scene & scene) {
+        if (!enabled) return;
+        if (!render || _matching_entities.size() == 0) return;
+
+        for (auto & ent_id : _matching_entities) {
+            if (!scene.is_valid_entity_id(ent_id) || !scene.system_query_matches(ent_id, _query)) continue;
+            _container.render_db[render](scene, ent_id);
+        }
+    }
+
     System & SystemContainer::make_system(const std::string & name, const SystemQuery & query) {
-        _systems.emplace(name, System(*this, name, query));
-        return _systems.at(name);
+        auto result = _systems.emplace(name, System(*this, name, query));
+        if (result.second) {
+            // nodes of unordered_map are stable, so holding pointers is fine
+            _ordered_systems.emplace_back(&result.first->second);
+        }
+        return result.first->second;
     }
 
     bool SystemContainer::has_system(const std::string & name) {
@@ -77,7 +157,16 @@ namespace smen {
         return it->second;
     }
 
+    void SystemContainer::pin_process_to_main_thread(const std::string & id) {
+        _main_thread_processes.emplace(id);
+    }
+
+    bool SystemContainer::is_process_pinned_to_main_thread(const std::string & id) const {
+        return _main_thread_processes.contains(id);
+    }
+
     void SystemContainer::clear() {
+        _ordered_systems.clear();
         _systems.clear();
     }
 }
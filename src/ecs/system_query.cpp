@@ -12,23 +12,36 @@ namespace smen {
 
     SystemQuery::SystemQuery(VariantTypeDirectory & dir)
     : _required_types()
+    , _mask()
     , _dir(dir)
     {}
 
     SystemQuery & SystemQuery::require_type(VariantTypeID type_id) {
+        if (!_dir.resolve(type_id).valid()) {
+            throw SystemQueryException("type with ID " + std::to_string(type_id) + " doesn't exist");
+        }
+
         _required_types.emplace_back(type_id);
+        _mask.set(type_id);
         return *this;
     }
 
     SystemQuery & SystemQuery::require_type(const std::string & name) {
-        _required_types.emplace_back(_dir.resolve(name).id);
-        return *this;
+        auto & type = _dir.resolve(name);
+        if (!type.valid()) {
+            throw SystemQueryException("type '" + name + "' doesn't exist");
+        }
+        return require_type(type.id);
     }
 
     const std::vector<VariantTypeID> & SystemQuery::required_type_ids() const {
         return _required_types;
     }
 
+    bool SystemQuery::matches(const ComponentMask & mask) const {
+        return mask.contains(_mask);
+    }
+
     void SystemQuery::write_string(std::ostream & s) const {
         s << "SystemQuery(";
         auto first = true;
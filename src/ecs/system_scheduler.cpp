@@ -0,0 +1,44 @@
+#include <smen/ecs/system_scheduler.hpp>
+#include <algorithm>
+
+namespace smen {
+    SystemScheduler::SystemScheduler()
+    : _stages()
+    , _stage_of()
+    {}
+
+    void SystemScheduler::build(const std::vector<System *> & systems, const Scene & scene) {
+        // stages are cleared rather than dropped to reuse their storage
+        for (auto & stage : _stages) {
+            stage.systems.clear();
+        }
+        _stage_of.assign(systems.size(), size_t(NOT_SCHEDULED));
+
+        size_t stage_count = 0;
+
+        for (size_t i = 0; i < systems.size(); i++) {
+            auto & system = *systems[i];
+            if (!system.enabled || !system.initialized_in(scene)) continue;
+
+            size_t stage_index = 0;
+            for (size_t j = 0; j < i; j++) {
+                if (_stage_of[j] == NOT_SCHEDULED) continue;
+                if (system.conflicts_with(*systems[j])) {
+                    stage_index = std::max(stage_index, _stage_of[j] + 1);
+                }
+            }
+
+            _stage_of[i] = stage_index;
+            stage_count = std::max(stage_count, stage_index + 1);
+            if (stage_index >= _stages.size()) _stages.resize(stage_index + 1);
+            _stages[stage_index].systems.emplace_back(&system);
+        }
+
+        _stages.resize(stage_count);
+        for (auto & stage : _stages) {
+            // systems that don't declare access conflict with every other
+            // system, so they always end up alone in their stage
+            stage.parallel = stage.systems.size() > 1;
+        }
+    }
+}
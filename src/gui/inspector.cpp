@@ -70,7 +70,8 @@ namespace smen {
             else Text("false");
             break;
         }
-        case VariantTypeCategory::STRING: {
+        case VariantTypeCategory::STRING:
+        case VariantTypeCategory::NAME: {
             auto value = variant.string();
                         if (InputText("##", &value)) {
                 variant.set_string(value);
@@ -81,8 +82,8 @@ namespace smen {
         case VariantTypeCategory::COMPONENT: {
             Indent();
 
-            for (auto & field_key : type.ordered_field_keys()) {
-                auto & field = type.field(field_key);
+            for (auto & field : type.fields()) {
+                auto & field_key = field.name;
                 auto & field_type = scene().dir().resolve(field.type_id);
                 auto field_variant = variant.get_field(field);
 
@@ -228,7 +229,7 @@ namespace smen {
 
         if (scene().has_children(entity_id)) {
             if (CollapsingHeader("Children")) {
-                auto & children = scene().children_of(entity_id);
+                auto children = scene().children_of(entity_id);
 
                 for (auto ent_id : children) {
                     if (CollapsingHeader(("Entity " + std::to_string(ent_id)).c_str())) {
@@ -427,8 +428,7 @@ namespace smen {
             if (InputText("##by_name", &_add_component_window.component_type)) {
             }
         } else if (BeginCombo("##list", _add_component_window.component_type == "" ? "Select type..." : _add_component_window.component_type.c_str())) {
-            for (auto & pair : scene().dir().types()) {
-                auto & type = pair.second;
+            for (auto & type : scene().dir().types()) {
                 if (type.generic_category == VariantGenericCategory::GENERIC_SPECIALIZED) continue;
                 if (type.category != VariantTypeCategory::COMPONENT) continue;
 
@@ -486,8 +486,7 @@ namespace smen {
             if (InputText("##by_name", &_create_variant_window.variant_type)) {
             }
         } else if (BeginCombo("##list", _create_variant_window.variant_type == "" ? "Select type..." : _create_variant_window.variant_type.c_str())) {
-            for (auto & pair : scene().dir().types()) {
-                auto & type = pair.second;
+            for (auto & type : scene().dir().types()) {
                 if (type.generic_category == VariantGenericCategory::GENERIC_SPECIALIZED) continue;
 
                 if (Selectable(type.name.c_str(), _create_variant_window.variant_type == type.name)) {
@@ -502,8 +501,7 @@ namespace smen {
                 if (InputText("##element_by_name", &_create_variant_window.element_type)) {
                 }
             } else if (BeginCombo("##element_list", _create_variant_window.element_type == "" ? "Select type..." : _create_variant_window.element_type.c_str())) {
-                for (auto & pair : scene().dir().types()) {
-                    auto & type = pair.second;
+                for (auto & type : scene().dir().types()) {
                     if (type.generic_category != VariantGenericCategory::NON_GENERIC) continue;
 
                     if (Selectable(type.name.c_str(), _create_variant_window.element_type == type.name)) {
@@ -724,8 +722,8 @@ namespace smen {
             InputText("##", &dtor_id);
         }
 
-        for (auto & field_key : type.ordered_field_keys()) {
-            auto & field = type.field(field_key);
+        for (auto & field : type.fields()) {
+            auto & field_key = field.name;
             auto & field_type = scene().dir().resolve(field.type_id);
 
             Text("%s", field_key.c_str());
@@ -742,8 +740,7 @@ namespace smen {
     void GUIInspector::draw_types_tab() {
         using namespace ImGui;
 
-        for (auto & pair : scene().dir().types()) {
-            auto & type = pair.second;
+        for (auto & type : scene().dir().types()) {
             if (type.generic_category == VariantGenericCategory::GENERIC_SPECIALIZED) continue;
 
             PushID("type");
@@ -141,6 +141,15 @@ namespace smen {
     LuaResult LuaNativeFunctionDiagnostics::error_expected(size_t index, const std::string & text) const {
         return LuaResult::error("argument #" + std::to_string(index) + " for function " + full_name() + " " + text);
     }
+
+    bool LuaNativeFunctionDiagnostics::has_arg(const LuaNativeFunctionArgs & args, size_t index) const {
+        auto real_index = index + upvalues;
+        if (self_type.size() == 0) {
+            real_index -= 1;
+        }
+
+        return real_index < args.size();
+    }
     
     const LuaObject & LuaNativeFunctionDiagnostics::arg(const LuaNativeFunctionArgs & args, size_t index) const {
         auto real_index = index + upvalues;
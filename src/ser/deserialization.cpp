@@ -303,6 +303,7 @@ namespace smen {
             else if (cat_name == "float64") cat = VariantTypeCategory::FLOAT64;
             else if (cat_name == "boolean") cat = VariantTypeCategory::BOOLEAN;
             else if (cat_name == "string") cat = VariantTypeCategory::STRING;
+            else if (cat_name == "name") cat = VariantTypeCategory::NAME;
             else if (cat_name == "list") cat = VariantTypeCategory::LIST;
             else if (cat_name == "reference") cat = VariantTypeCategory::REFERENCE;
             else {
@@ -327,6 +328,8 @@ namespace smen {
         tok = _lexer.next_expect_header_end();
 
         auto type_builder = VariantTypeBuilder(_dir, cat, name);
+        // field offsets are never serialized, so they can be chosen freely
+        type_builder.reorder_fields();
         
         auto peek_tok = _lexer.peek();
         while (peek_tok.type != Lexer::TokenType::HEADER_LIST_BEGIN && peek_tok.type != Lexer::TokenType::END_OF_FILE) {
@@ -388,6 +391,7 @@ namespace smen {
         case VariantTypeCategory::FLOAT64:
         case VariantTypeCategory::BOOLEAN:
         case VariantTypeCategory::STRING:
+        case VariantTypeCategory::NAME:
             _lexer.check_string(ref, "value for '" + type.name + "' " + field_text);
             break;
         case VariantTypeCategory::REFERENCE:
@@ -463,6 +467,7 @@ namespace smen {
             variant.set_boolean(ref.content == "true");
             break;
         case VariantTypeCategory::STRING:
+        case VariantTypeCategory::NAME:
             variant.set_string(ref.content);
             break;
         case VariantTypeCategory::REFERENCE: {
@@ -663,6 +668,19 @@ namespace smen {
             }
 
             system.render = value;
+        } else if (field_tok.content == "reads" || field_tok.content == "writes") {
+            // may be given any number of times, once per component type
+            auto & type = _scene.dir().resolve(value);
+            if (!type.valid()) {
+                throw DeserializationException(tok.region, "type '" + value + "' referenced in system access does not exist");
+            }
+
+            if (type.category != VariantTypeCategory::COMPONENT) {
+                throw DeserializationException(tok.region, "type '" + value + "' referenced in system access is not a component type");
+            }
+
+            if (field_tok.content == "reads") system.reads(type.id);
+            else system.writes(type.id);
         } else {
             throw DeserializationException(tok.region, "invalid special system field: '" + field_tok.content + "'");
         }
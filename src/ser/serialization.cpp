@@ -75,8 +75,7 @@ namespace smen {
         _serialized_type_ids.emplace(type.id);
 
         if (type.is_compound_type()) {
-            for (auto & pair : type.fields()) {
-                auto & field = pair.second;
+            for (auto & field : type.fields()) {
                 auto * field_type = &_dir.resolve(field.type_id);
 
                 if (field_type->generic_category == VariantGenericCategory::GENERIC_SPECIALIZED) {
@@ -120,6 +119,9 @@ namespace smen {
         case VariantTypeCategory::STRING:
             _s << "valuetype string";
             break;
+        case VariantTypeCategory::NAME:
+            _s << "valuetype name";
+            break;
         case VariantTypeCategory::LIST:
             _s << "valuetype list";
             break;
@@ -161,10 +163,10 @@ namespace smen {
 
             auto first = true;
 
-            for (auto & field_key : type.ordered_field_keys()) {
+            for (auto & field : type.fields()) {
                 if (!first) _s << "\n";
                 first = false;
-                serialize(type.field(field_key));
+                serialize(field);
             }
         }
 
@@ -172,8 +174,8 @@ namespace smen {
     }
 
     void TypeSerializer::serialize_all() {
-        for (auto & pair : _dir.types()) {
-            serialize(pair.second);
+        for (auto & type : _dir.types()) {
+            serialize(type);
         }
     }
 
@@ -186,8 +188,7 @@ namespace smen {
 
     void VariantSerializer::_serialize_references(const Variant & variant, const VariantType & type) {
         if (type.is_compound_type()) {
-            for (auto & pair : type.fields()) {
-                auto & field = pair.second;
+            for (auto & field : type.fields()) {
                 auto & field_type = _container.dir.resolve(field.type_id);
 
                 auto field_variant = variant.get_field(field);
@@ -276,6 +277,7 @@ namespace smen {
             _s << variant.float64();
             break;
         case VariantTypeCategory::STRING:
+        case VariantTypeCategory::NAME:
             _s << field_key << " = ";
             smen::write_escaped_string(_s, variant.string());
             break;
@@ -319,12 +321,8 @@ namespace smen {
                 _s << field_key << " = ";
                 _s << "{";
             }
-            auto & inner_field_keys = type.ordered_field_keys();
             auto first = true;
-            for (size_t i = 0; i < inner_field_keys.size(); i++) {
-                auto & inner_field_key = inner_field_keys[i];
-                auto & field = type.field(inner_field_key);
-
+            for (auto & field : type.fields()) {
                 auto field_variant = variant.get_field(field);
 
                 if (!field.has_attribute(VariantTypeFieldAttribute::ALWAYS_SERIALIZE)) {
@@ -407,6 +405,16 @@ namespace smen {
             _s << "\n";
             _s << "@render = " << system.render;
         }
+
+        for (auto & type_id : system.read_mask().type_ids()) {
+            _s << "\n";
+            _s << "@reads = " << _scene.dir().resolve(type_id).name;
+        }
+
+        for (auto & type_id : system.write_mask().type_ids()) {
+            _s << "\n";
+            _s << "@writes = " << _scene.dir().resolve(type_id).name;
+        }
     }
 
     void SceneSerializer::serialize_entity(EntityID ent_id) {
@@ -450,13 +458,23 @@ namespace smen {
         write_escaped_string(_s, script.path());
     }
 
-    void SceneSerializer::serialize_entities() {
-        auto first = true;
-        for (auto ent_id : _scene) {
+    void SceneSerializer::_serialize_entity_tree(EntityID ent_id, bool & first) {
+        for (auto & entry : _scene.hierarchy().depth_order(ent_id)) {
             if (!first) _s << "\n\n";
             first = false;
 
-            serialize_entity(ent_id);
+            serialize_entity(entry.id);
+        }
+    }
+
+    void SceneSerializer::serialize_entities() {
+        // the scene doesn't iterate in creation order, so each root is
+        // written in depth order, as the deserializer needs to know the
+        // parent of an entity by the time it reads it
+        auto first = true;
+        for (auto ent_id : _scene) {
+            if (_scene.has_parent(ent_id)) continue;
+            _serialize_entity_tree(ent_id, first);
         }
     }
 
@@ -486,7 +504,7 @@ namespace smen {
         write_escaped_string(_s, _scene.name());
         _s << "\n\n";
 
-        if (_scene.entity_container().max_entity_id() > 0) {
+        if (_scene.entity_container().size() > 0) {
             serialize_entities();
             _s << "\n\n";
         }
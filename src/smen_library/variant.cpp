@@ -1,6 +1,8 @@
 #include <smen/lua/library.hpp>
 #include <smen/smen_library/variant.hpp>
 #include <smen/ecs/scene.hpp>
+#include <smen/ecs/prefab.hpp>
+#include <cmath>
 
 namespace smen {
     LuaVariantLibrary::LuaVariantLibrary(VariantContainer & variant_alloc, LuaEngine & engine)
@@ -25,6 +27,7 @@ namespace smen {
         _load_keyboard_support(table);
 
         _load_scene_support(table);
+        _load_prefab_support(table);
         _load_system_callback_support(table);
 
         _load_window_support(table);
@@ -103,6 +106,7 @@ namespace smen {
             case VariantTypeCategory::BOOLEAN:
                 return engine.boolean(field_variant.boolean());
             case VariantTypeCategory::STRING:
+            case VariantTypeCategory::NAME:
                 return engine.string(field_variant.string());
             case VariantTypeCategory::INT32:
                 return engine.number(field_variant.int32());
@@ -214,6 +218,7 @@ namespace smen {
             } else if (value_type == LuaType::STRING) {
                 switch(field_type.category) {
                 case VariantTypeCategory::STRING:
+                case VariantTypeCategory::NAME:
                     field_variant->set_string(value.string());
                     break;
                 default:
@@ -798,7 +803,7 @@ namespace smen {
 
         auto table = engine.new_table();
         auto component_type = diag.arg(args, 2).string();
-        auto & child_entity_ids = self.children_of(entity_id);
+        auto child_entity_ids = self.children_of(entity_id);
         LuaNumber index = 0;
         for (auto & ent_id : child_entity_ids) {
             index += 1;
@@ -954,6 +959,87 @@ namespace smen {
         return engine.number(self.spawn_child(parent_id, name));
     }
 
+    // reads the optional instance count argument, which must be a whole
+    // number between 1 and the number of entities a scene can hold
+    static bool check_instance_count(LuaResult & result, LuaEngine & engine, const LuaNativeFunctionDiagnostics & diag, const LuaNativeFunctionArgs & args, size_t index, size_t & count) {
+        count = 1;
+        if (!diag.has_arg(args, index) || diag.arg(args, index).type() == LuaType::NIL) return true;
+        if (!diag.check(result, engine, args, index, { LuaType::NUMBER })) return false;
+
+        auto value = diag.arg(args, index).number();
+        if (!(value >= 1 && value <= LuaNumber(ENTITY_INDEX_MASK)) || std::floor(value) != value) {
+            result = diag.error_expected(index, "- expected a whole number of instances between 1 and " + std::to_string(ENTITY_INDEX_MASK) + ", got " + diag.arg(args, index).to_string_lua());
+            return false;
+        }
+
+        count = static_cast<size_t>(value);
+        return true;
+    }
+
+    static LuaObject entity_id_table(LuaEngine & engine, const std::vector<EntityID> & ids) {
+        auto table = engine.new_table();
+        LuaNumber index = 0;
+        for (auto & ent_id : ids) {
+            index += 1;
+            table.set(index, engine.number(ent_id));
+        }
+        return table;
+    }
+
+    LuaResult LuaVariantLibrary::_scene_instantiate_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
+        static const auto diag = LuaNativeFunctionDiagnostics {
+            .name = "instantiate",
+            .self_type = "Scene",
+            .return_type = "table[entity_id]",
+
+            .args = {
+                { .name = "template_id", .type = "entity_id" },
+                { .name = "count", .type = "number|nil" },
+            }
+        };
+
+        LuaResult r;
+        if (!diag.check_self(r, engine, args)) return r;
+        if (!diag.check(r, engine, args, 1, { LuaType::NUMBER })) return r;
+
+        size_t count;
+        if (!check_instance_count(r, engine, diag, args, 2, count)) return r;
+
+        auto & self = ** diag.self(args).userdata<Scene *>();
+
+        auto template_id = static_cast<EntityID>(diag.arg(args, 1).number());
+
+        // captures the template on every call, scripts that instantiate
+        // the same template repeatedly should use Scene:capture instead
+        auto prefab = Prefab::capture(self, template_id);
+        return entity_id_table(engine, prefab.instantiate(self, count));
+    }
+
+    LuaResult LuaVariantLibrary::_scene_capture_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
+        static const auto diag = LuaNativeFunctionDiagnostics {
+            .name = "capture",
+            .self_type = "Scene",
+            .return_type = "Prefab",
+
+            .args = {
+                { .name = "template_id", .type = "entity_id" },
+            }
+        };
+
+        LuaResult r;
+        if (!diag.check_self(r, engine, args)) return r;
+        if (!diag.check(r, engine, args, 1, { LuaType::NUMBER })) return r;
+
+        auto * self = * diag.self(args).userdata<Scene *>();
+
+        auto template_id = static_cast<EntityID>(diag.arg(args, 1).number());
+
+        return engine.native_type_move("Prefab", LuaScenePrefab {
+            .scene = self,
+            .prefab = Prefab::capture(*self, template_id)
+        });
+    }
+
     LuaResult LuaVariantLibrary::_scene_make_orphan_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
         static const auto diag = LuaNativeFunctionDiagnostics {
             .name = "make_orphan",
@@ -1133,6 +1219,49 @@ namespace smen {
         return LuaResult();
     }
 
+    LuaResult LuaVariantLibrary::_scene_kill_recursive_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
+        static const auto diag = LuaNativeFunctionDiagnostics {
+            .name = "kill_recursive",
+            .self_type = "Scene",
+
+            .args = {
+                { .name = "entity_id", .type = "entity_id" },
+            }
+        };
+
+        LuaResult r;
+        if (!diag.check_self(r, engine, args)) return r;
+        if (!diag.check(r, engine, args, 1, { LuaType::NUMBER })) return r;
+
+        auto & self = ** diag.self(args).userdata<Scene *>();
+
+        auto entity_id = static_cast<EntityID>(diag.arg(args, 1).number());
+
+        return engine.number(self.kill_recursive(entity_id));
+    }
+
+    LuaResult LuaVariantLibrary::_scene_defer_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
+        static const auto diag = LuaNativeFunctionDiagnostics {
+            .name = "defer",
+            .self_type = "Scene",
+
+            .args = {
+                { .name = "func", .type = "function" },
+            }
+        };
+
+        LuaResult r;
+        if (!diag.check_self(r, engine, args)) return r;
+        if (!diag.check(r, engine, args, 1, { LuaType::FUNCTION })) return r;
+
+        auto & self = ** diag.self(args).userdata<Scene *>();
+
+        // entity and component events caused by the function are
+        // delivered to systems in one batch once it returns
+        SceneDeferScopeGuard scope(self);
+        return diag.arg(args, 1).call();
+    }
+
     void LuaVariantLibrary::_load_scene_support(LuaObject & table) {
         auto & typedesc = _engine->create_native_type<Scene *>("Scene")
             .copy_ctor([](const smen::LuaEngine & engine, Scene * const & source, Scene * * target) {
@@ -1177,6 +1306,8 @@ namespace smen {
         typedesc.add_shared_object("adopt_child", _engine->function(_scene_adopt_child_func));
         typedesc.add_shared_object("spawn_child", _engine->function(_scene_spawn_child_func));
         typedesc.add_shared_object("make_orphan", _engine->function(_scene_make_orphan_func));
+        typedesc.add_shared_object("instantiate", _engine->function(_scene_instantiate_func));
+        typedesc.add_shared_object("capture", _engine->function(_scene_capture_func));
 
         typedesc.add_shared_object("remove_component", _engine->function(_scene_remove_component_func));
         typedesc.add_shared_object("find_first_by_name", _engine->function(_scene_find_first_by_name_func));
@@ -1184,6 +1315,64 @@ namespace smen {
         typedesc.add_shared_object("name_of", _engine->function(_scene_name_of_func));
         typedesc.add_shared_object("set_name", _engine->function(_scene_set_name_func));
         typedesc.add_shared_object("kill", _engine->function(_scene_kill_func));
+        typedesc.add_shared_object("kill_recursive", _engine->function(_scene_kill_recursive_func));
+        typedesc.add_shared_object("defer", _engine->function(_scene_defer_func));
+    }
+
+    LuaResult LuaVariantLibrary::_prefab_instantiate_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
+        static const auto diag = LuaNativeFunctionDiagnostics {
+            .name = "instantiate",
+            .self_type = "Prefab",
+            .return_type = "table[entity_id]",
+
+            .args = {
+                { .name = "count", .type = "number|nil" },
+            }
+        };
+
+        LuaResult r;
+        if (!diag.check_self(r, engine, args)) return r;
+
+        size_t count;
+        if (!check_instance_count(r, engine, diag, args, 1, count)) return r;
+
+        auto & self = * diag.self(args).userdata<LuaScenePrefab>();
+
+        return entity_id_table(engine, self.prefab.instantiate(*self.scene, count));
+    }
+
+    void LuaVariantLibrary::_load_prefab_support(LuaObject & table) {
+        auto & typedesc = _engine->create_native_type<LuaScenePrefab>("Prefab")
+            .move_ctor([](const smen::LuaEngine & engine, LuaScenePrefab && source, LuaScenePrefab * target) {
+                new (target) LuaScenePrefab(std::move(source));
+            })
+
+            .dtor([](const smen::LuaEngine & engine, LuaScenePrefab & target) {
+                target.~LuaScenePrefab();
+            })
+
+            .to_string([](const smen::LuaEngine & engine, const LuaScenePrefab & target) -> std::string {
+                std::ostringstream s;
+                s << "Prefab(";
+                s << target.prefab.size();
+                s << " entities)";
+                return s.str();
+            })
+
+            .get([](const smen::LuaEngine & engine, const LuaScenePrefab & target, const LuaObject & key) -> LuaResult {
+                if (key.type() != LuaType::STRING) return engine.nil();
+                auto key_str = key.string();
+                if (key_str == "size") return engine.number(target.prefab.size());
+                return engine.nil();
+            })
+
+            .eq([](const smen::LuaEngine & engine, const LuaScenePrefab & lhs, const LuaScenePrefab & rhs) -> bool {
+                return &lhs == &rhs;
+            });
+
+        typedesc.add_shared_object("instantiate", _engine->function(_prefab_instantiate_func));
+
+        table.set("Prefab", typedesc.metatype);
     }
 
     LuaResult LuaVariantLibrary::_renderer_render_func(LuaEngine & engine, const LuaNativeFunctionArgs & args) {
@@ -1486,6 +1675,7 @@ namespace smen {
                     auto result = func.call({ engine.number(ent_id), engine.number(delta) });
                     if (result.fail()) throw std::runtime_error("error in system.process function '" + name + "': " + result.error_msg());
                 });
+                system_container.pin_process_to_main_thread(name);
 
                 lib._func_db_process_list.emplace_back(std::move(new_entry));
             } else if (db == "system.render") {
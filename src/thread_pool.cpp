@@ -0,0 +1,172 @@
+#include <smen/thread_pool.hpp>
+
+namespace smen {
+    // worker indices are only meaningful together with their pool
+    static thread_local const ThreadPool * current_pool = nullptr;
+    static thread_local size_t current_worker = ThreadPool::NOT_A_WORKER;
+    static thread_local size_t running_tasks = 0;
+
+    ThreadPoolTaskGroup::ThreadPoolTaskGroup()
+    : pending(0)
+    , error()
+    {}
+
+    ThreadPool::ThreadPool(size_t thread_count)
+    : _queues()
+    , _threads()
+    , _state_mutex()
+    , _wake()
+    , _done()
+    , _queued(0)
+    , _next_queue(0)
+    , _stopping(false)
+    , _default_group()
+    {
+        if (thread_count == 0) thread_count = 1;
+
+        for (size_t i = 0; i < thread_count; i++) {
+            _queues.emplace_back(std::make_unique<WorkerQueue>());
+        }
+
+        for (size_t i = 0; i < thread_count; i++) {
+            _threads.emplace_back([this, i]() { _worker_main(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_state_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+
+        for (auto & thread : _threads) {
+            thread.join();
+        }
+    }
+
+    size_t ThreadPool::current_worker_index() const {
+        if (current_pool != this) return NOT_A_WORKER;
+        return current_worker;
+    }
+
+    bool ThreadPool::running_task() {
+        return running_tasks > 0;
+    }
+
+    size_t ThreadPool::default_thread_count() {
+        auto hw_threads = std::thread::hardware_concurrency();
+        if (hw_threads <= 1) return 1;
+        return hw_threads - 1;
+    }
+
+    bool ThreadPool::_pop_own(size_t worker_index, QueuedTask & task) {
+        auto & queue = *_queues[worker_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        _queued -= 1;
+        return true;
+    }
+
+    bool ThreadPool::_steal(size_t start_index, QueuedTask & task) {
+        for (size_t i = 0; i < _queues.size(); i++) {
+            auto & queue = *_queues[(start_index + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            _queued -= 1;
+            return true;
+        }
+        return false;
+    }
+
+    void ThreadPool::_run(QueuedTask & task) {
+        auto & group = *task.group;
+
+        running_tasks += 1;
+        try {
+            task.task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_state_mutex);
+            if (!group.error) group.error = std::current_exception();
+        }
+        running_tasks -= 1;
+
+        if (group.pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(_state_mutex);
+            _done.notify_all();
+        }
+    }
+
+    void ThreadPool::_worker_main(size_t worker_index) {
+        current_pool = this;
+        current_worker = worker_index;
+
+        while (true) {
+            QueuedTask task;
+            if (_pop_own(worker_index, task) || _steal(worker_index + 1, task)) {
+                _run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_state_mutex);
+            _wake.wait(lock, [&]() { return _stopping || _queued > 0; });
+            if (_stopping) return;
+        }
+    }
+
+    void ThreadPool::submit(ThreadPoolTaskGroup & group, ThreadPoolTask task) {
+        // tasks submitted from a worker go to its own queue, which keeps
+        // related work on one thread unless someone else is idle
+        auto queue_index = current_worker_index();
+        if (queue_index == NOT_A_WORKER) {
+            queue_index = _next_queue.fetch_add(1) % _queues.size();
+        }
+
+        group.pending += 1;
+        {
+            auto & queue = *_queues[queue_index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(QueuedTask { .task = std::move(task), .group = &group });
+            _queued += 1;
+        }
+
+        // taking the lock makes sure a thread that just found no work
+        // is either already waiting or will see the new task
+        {
+            std::lock_guard<std::mutex> lock(_state_mutex);
+        }
+        _wake.notify_one();
+        _done.notify_all();
+    }
+
+    void ThreadPool::wait(ThreadPoolTaskGroup & group) {
+        auto start_index = current_worker_index();
+        if (start_index == NOT_A_WORKER) start_index = 0;
+
+        while (group.pending > 0) {
+            // help with whatever is queued, it's either part of the
+            // group or holding up a worker that could run the group
+            QueuedTask task;
+            if (_steal(start_index, task)) {
+                _run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_state_mutex);
+            _done.wait(lock, [&]() { return group.pending == 0 || _queued > 0; });
+        }
+
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(_state_mutex);
+            std::swap(error, group.error);
+        }
+        if (error) std::rethrow_exception(error);
+    }
+}
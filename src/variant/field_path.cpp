@@ -0,0 +1,68 @@
+#include <smen/variant/field_path.hpp>
+#include <sstream>
+
+namespace smen {
+    VariantFieldPath::VariantFieldPath(const VariantTypeDirectory & dir, VariantTypeID root_type_id, const std::string & path)
+    : _path(path)
+    , _root_type_id(root_type_id)
+    , _type_id(root_type_id)
+    , _category(VariantTypeCategory::INVALID)
+    , _offset_bytes(0)
+    , _size(0)
+    {
+        auto * type = &dir.resolve(root_type_id);
+        if (!type->valid()) {
+            throw VariantFieldPathException("root type of path '" + path + "' doesn't exist");
+        }
+
+        size_t start = 0;
+        while (start <= path.size()) {
+            auto end = path.find('.', start);
+            if (end == std::string::npos) end = path.size();
+            auto name = path.substr(start, end - start);
+
+            if (!type->is_compound_type()) {
+                throw VariantFieldPathException("'" + name + "' in path '" + path + "' is a field of '" + type->name + "', which has no fields");
+            }
+
+            auto & field = type->field(name);
+            if (!field) {
+                throw VariantFieldPathException("type '" + type->name + "' has no field '" + name + "' (in path '" + path + "')");
+            }
+
+            _offset_bytes += field.offset_bytes;
+            _type_id = field.type_id;
+            type = &dir.resolve(field.type_id);
+
+            start = end + 1;
+        }
+
+        _category = type->category;
+        _size = type->size();
+    }
+
+    void * VariantFieldPath::_ptr(const Variant & variant) const {
+        if (!applies_to(variant)) {
+            throw VariantFieldPathException("path '" + _path + "' used with a variant of a different type");
+        }
+
+        return reinterpret_cast<std::byte *>(variant.content_ptr().ptr()) + _offset_bytes;
+    }
+
+    bool VariantFieldPath::applies_to(const Variant & variant) const {
+        return variant.storage_mode() == VariantStorageMode::HEAP && variant.type_id() == _root_type_id;
+    }
+
+    void VariantFieldPath::_check_category(VariantTypeCategory category) const {
+        if (category != _category) {
+            auto s = std::ostringstream();
+            s << "field at path '" << _path << "' is of category " << _category << ", but was accessed as " << category;
+            throw VariantFieldPathException(s.str());
+        }
+    }
+
+    Variant VariantFieldPath::get(const Variant & variant) const {
+        auto * ptr = _ptr(variant);
+        return Variant(variant.container(), VariantEntryContent(ptr, variant.content_ptr().root_type_id), _type_id);
+    }
+}
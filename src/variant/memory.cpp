@@ -4,6 +4,9 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <bit>
+#include <cstdlib>
+#include <algorithm>
 
 namespace smen {
     const VariantEntry VariantEntry::INVALID_ENTRY = VariantEntry(nullptr, INVALID_VARIANT_TYPE_ID);
@@ -33,221 +36,375 @@ namespace smen {
         return dir.resolve(type_id);
     }
 
-    void VariantContainer::_determine_ctor_dtor_behavior(const VariantType & type, bool & requires_ctor, bool & requires_dtor) const {
-        if (type.ctor && type.dtor) {
-            requires_ctor = true;
-            requires_dtor = true;
-        } else {
-            if (type.ctor) requires_ctor = true;
-            if (type.dtor) requires_dtor = true;
-            for (auto & pair : type.fields()) {
-                auto field_type = dir.resolve(pair.second.type_id);
-                _determine_ctor_dtor_behavior(field_type, requires_ctor, requires_dtor);
+    static bool has_builtin_ctor(const VariantTypeDirectory & dir, const VariantType & type, VariantTypeID builtin_type_id) {
+        return static_cast<const std::string &>(type.ctor) == static_cast<const std::string &>(dir.resolve(builtin_type_id).ctor);
+    }
+
+    static bool has_builtin_dtor(const VariantTypeDirectory & dir, const VariantType & type, VariantTypeID builtin_type_id) {
+        return static_cast<const std::string &>(type.dtor) == static_cast<const std::string &>(dir.resolve(builtin_type_id).dtor);
+    }
+
+    static void compile_lifecycle_plans(const VariantTypeDirectory & dir, const VariantType & type, size_t offset_bytes, VariantTypeLayout & layout) {
+        if (type.dtor) {
+            auto step = VariantLifecycleStep {
+                .op = VariantLifecycleOp::DESTROY_CUSTOM,
+                .offset_bytes = offset_bytes,
+                .type = &type,
+                .callback_id = {}
+            };
+
+            // builtin dtors are run inline instead of through the database
+            if (type.category == VariantTypeCategory::STRING && has_builtin_dtor(dir, type, dir.string())) {
+                step.op = VariantLifecycleOp::DESTROY_STRING;
+            } else if (type.category == VariantTypeCategory::LIST && has_builtin_dtor(dir, type, dir.list())) {
+                step.op = VariantLifecycleOp::DESTROY_LIST;
+            } else if (type.category == VariantTypeCategory::REFERENCE && has_builtin_dtor(dir, type, dir.reference())) {
+                step.op = VariantLifecycleOp::DESTROY_REFERENCE;
+            } else {
+                step.callback_id = type.dtor;
             }
+            layout.dtor_plan.emplace_back(std::move(step));
         }
-    }
 
-    void VariantContainer::_construct(const VariantType & type, VariantEntryContent content) {
         if (type.is_compound_type()) {
-            // default ctor (all fields)
-            for (auto & pair : type.fields()) {
-                _construct(dir.resolve(pair.second.type_id), content.of_field(pair.second));
+            for (auto & field : type.fields()) {
+                compile_lifecycle_plans(dir, dir.resolve(field.type_id), offset_bytes + field.offset_bytes, layout);
             }
         }
 
         if (type.ctor) {
-            dir.ctor_db[type.ctor](*this, type, content);
-        }
-
-        return;
-
-        if (type.category == VariantTypeCategory::REFERENCE) {
-            VariantReference::NULL_REFERENCE.write(content.ptr());
-        } else if (type.category == VariantTypeCategory::LIST) {
-            std::construct_at(reinterpret_cast<std::vector<VariantIndex> *>(content.ptr()));
-        } else {
-            for (auto & pair : type.fields()) {
-                auto & field_type = dir.resolve(pair.second.type_id);
-                if (field_type.category == VariantTypeCategory::COMPLEX) {
-                    _construct(field_type, content.of_field(pair.second));
-                }
+            auto step = VariantLifecycleStep {
+                .op = VariantLifecycleOp::CONSTRUCT_CUSTOM,
+                .offset_bytes = offset_bytes,
+                .type = &type,
+                .callback_id = {}
+            };
+
+            if (type.category == VariantTypeCategory::STRING && has_builtin_ctor(dir, type, dir.string())) {
+                step.op = VariantLifecycleOp::CONSTRUCT_STRING;
+            } else if (type.category == VariantTypeCategory::LIST && has_builtin_ctor(dir, type, dir.list())) {
+                step.op = VariantLifecycleOp::CONSTRUCT_LIST;
+            } else if (type.category == VariantTypeCategory::REFERENCE && has_builtin_ctor(dir, type, dir.reference())) {
+                step.op = VariantLifecycleOp::CONSTRUCT_REFERENCE;
+            } else {
+                step.callback_id = type.ctor;
             }
+            layout.ctor_plan.emplace_back(std::move(step));
         }
     }
 
-    void VariantContainer::_destroy(const VariantType & type, VariantEntryContent content) {
-        if (type.dtor) {
-            dir.dtor_db[type.dtor](*this, type, content);
+    VariantTypeLayout VariantTypeLayout::compile(const VariantTypeDirectory & dir, const VariantType & type) {
+        const auto refcounter_size = VariantSingleTypeContainer::REFCOUNTER_SIZE;
+        auto content_alignment = type.alignment();
+
+        auto layout = VariantTypeLayout {
+            .type_id = type.id,
+            .size = type.size(),
+            .alignment = std::max(refcounter_size, content_alignment),
+            .content_offset = (refcounter_size + content_alignment - 1) / content_alignment * content_alignment,
+            .stride = 0,
+            .requires_ctor = false,
+            .requires_dtor = false,
+            .fields = {},
+            .ctor_plan = {},
+            .dtor_plan = {}
+        };
+
+        // rounded up so that both the refcount and the content
+        // of every entry are suitably aligned
+        auto size = layout.content_offset + layout.size;
+        layout.stride = (size + layout.alignment - 1) / layout.alignment * layout.alignment;
+
+        compile_lifecycle_plans(dir, type, 0, layout);
+        layout.requires_ctor = !layout.ctor_plan.empty();
+        layout.requires_dtor = !layout.dtor_plan.empty();
+
+        layout.fields.reserve(type.field_count());
+        for (auto & field : type.fields()) {
+            layout.fields.emplace_back(VariantTypeLayoutField {
+                .type_id = field.type_id,
+                .offset_bytes = field.offset_bytes,
+                .size = dir.resolve(field.type_id).size()
+            });
         }
 
-        if (type.is_compound_type()) {
-            // default dtor (all fields)
-            for (auto & pair : type.fields()) {
-                _destroy(dir.resolve(pair.second.type_id), content.of_field(pair.second));
+        return layout;
+    }
+
+    size_t VariantTypeLayout::padding_bytes() const {
+        auto used = size;
+        if (!fields.empty()) {
+            used = 0;
+            for (auto & field : fields) {
+                used += field.size;
             }
         }
-        return;
+        return stride - VariantSingleTypeContainer::REFCOUNTER_SIZE - used;
+    }
 
-        if (type.category == VariantTypeCategory::REFERENCE) {
-            auto ref_value = VariantReference::read(type.element_type_id, content.ptr());
-            if (ref_value) {
-                auto & type_alloc = get_container_of(ref_value.type_id);
-                decref(type_alloc.entry_at(ref_value.index));
-            }
-        } else if (type.category == VariantTypeCategory::LIST) {
-            auto * vec_ptr = reinterpret_cast<std::vector<VariantIndex> *>(content.ptr());
-            for (size_t i = 0; i < vec_ptr->size(); i++) {
-                auto ent = entry_at(type.element_type_id, vec_ptr->at(i));
-                decref(ent);
+    void VariantContainer::_construct(const VariantTypeLayout & layout, VariantEntryContent content) {
+        auto * base = reinterpret_cast<std::byte *>(content.ptr());
+
+        for (auto & step : layout.ctor_plan) {
+            auto * ptr = base + step.offset_bytes;
+
+            switch(step.op) {
+            case VariantLifecycleOp::CONSTRUCT_STRING:
+                std::construct_at(reinterpret_cast<std::string *>(ptr));
+                break;
+            case VariantLifecycleOp::CONSTRUCT_LIST:
+                std::construct_at(reinterpret_cast<std::vector<Variant> *>(ptr));
+                break;
+            case VariantLifecycleOp::CONSTRUCT_REFERENCE:
+                VariantReference::NULL_REFERENCE.write(ptr);
+                break;
+            case VariantLifecycleOp::CONSTRUCT_CUSTOM:
+                dir.ctor_db[step.callback_id](*this, *step.type, VariantEntryContent(ptr, content.root_type_id));
+                break;
+            default:
+                break;
             }
+        }
+    }
 
-            std::destroy_at(vec_ptr);
-        } else if (type.category == VariantTypeCategory::STRING) {
-            auto * str_ptr = reinterpret_cast<std::string *>(content.ptr());
-            std::destroy_at(str_ptr);
-        } else if (type.category == VariantTypeCategory::COMPLEX) {
-            for (auto & pair : type.fields()) {
-                _destroy(dir.resolve(pair.second.type_id), content.of_field(pair.second));
+    void VariantContainer::_destroy(const VariantTypeLayout & layout, VariantEntryContent content) {
+        auto * base = reinterpret_cast<std::byte *>(content.ptr());
+
+        for (auto & step : layout.dtor_plan) {
+            auto * ptr = base + step.offset_bytes;
+
+            switch(step.op) {
+            case VariantLifecycleOp::DESTROY_STRING:
+                std::destroy_at(reinterpret_cast<std::string *>(ptr));
+                break;
+            case VariantLifecycleOp::DESTROY_LIST:
+                std::destroy_at(reinterpret_cast<std::vector<Variant> *>(ptr));
+                break;
+            case VariantLifecycleOp::DESTROY_REFERENCE: {
+                auto ref_value = VariantReference::read(step.type->element_type_id, ptr);
+                if (ref_value) decref(entry_at(ref_value.type_id, ref_value.index));
+                break;
+            }
+            case VariantLifecycleOp::DESTROY_CUSTOM:
+                dir.dtor_db[step.callback_id](*this, *step.type, VariantEntryContent(ptr, content.root_type_id));
+                break;
+            default:
+                break;
             }
         }
     }
 
-    VariantSingleTypeContainer::VariantSingleTypeContainer(VariantTypeDirectory & dir, VariantTypeID type_id, bool requires_ctor, bool requires_dtor)
-    : _ptr(nullptr)
-    , _alloc_counter(0)
-    , _pos(0)
-    , _capacity(0)
+    size_t VariantSingleTypeContainer::_page_size_for(const VariantTypeLayout & layout) {
+        auto min_size = PAGE_HEADER_SIZE + layout.stride * MIN_ENTRIES_PER_PAGE;
+        return std::max(size_t(PAGE_SIZE), std::bit_ceil(min_size));
+    }
+
+    VariantSingleTypeContainer::VariantSingleTypeContainer(VariantTypeDirectory & dir, const VariantTypeLayout & layout)
+    : _page_size(_page_size_for(layout))
+    , _entries_per_page(static_cast<VariantIndex>((_page_size - PAGE_HEADER_SIZE) / layout.stride))
+    , _page_table(nullptr)
+    , _page_count(0)
     , _length(0)
+    , _page_tables()
+    , _page_table_capacity(0)
+    , _capacity(0)
+    , _free_head(NO_FREE_ENTRY)
+    , _free_count(0)
+    , _alloc_mutex()
     , dir(dir)
-    , type_id(type_id)
-    , requires_ctor(requires_ctor)
-    , requires_dtor(requires_dtor)
+    , type_id(layout.type_id)
+    , layout(layout)
     {}
 
     bool VariantSingleTypeContainer::_enlarge() {
-        size_t new_capacity;
-
-        if (_capacity == 0) new_capacity = INITIAL_CAPACITY;
-        else new_capacity = _capacity * ENLARGE_FACTOR;
+        auto page_count = _page_count.load(std::memory_order_relaxed);
+        if (page_count >= NO_FREE_ENTRY / _entries_per_page) return false;
+
+        auto * page = reinterpret_cast<std::byte *>(std::aligned_alloc(_page_size, _page_size));
+        if (page == nullptr) return false;
+
+        std::construct_at(reinterpret_cast<VariantPageHeader *>(page), VariantPageHeader {
+            .page_index = static_cast<VariantIndex>(page_count)
+        });
+
+        if (page_count == _page_table_capacity) {
+            // readers may still be using the old table, so it's kept
+            auto capacity = std::max(size_t(MIN_PAGE_TABLE_CAPACITY), _page_table_capacity * 2);
+            auto table = std::make_unique<std::byte *[]>(capacity);
+            std::copy_n(_page_table.load(std::memory_order_relaxed), page_count, table.get());
+            _page_table.store(table.get(), std::memory_order_release);
+            _page_tables.emplace_back(std::move(table));
+            _page_table_capacity = capacity;
+        }
 
-        void * new_ptr = realloc(_ptr, new_capacity * entry_size());
-        if (new_ptr == nullptr) return false;
-        _ptr = new_ptr;
-        _capacity = new_capacity;
+        // the slot isn't visible to readers until the page count is bumped
+        _page_table.load(std::memory_order_relaxed)[page_count] = page;
+        _page_count.store(page_count + 1, std::memory_order_release);
+        _capacity += _entries_per_page;
         return true;
     }
 
-    const VariantType & VariantSingleTypeContainer::type() const {
-        return dir.resolve(type_id);
+    std::byte * VariantSingleTypeContainer::_slot_ptr(VariantIndex idx) const {
+        auto page = idx / _entries_per_page;
+        auto slot = idx % _entries_per_page;
+        return _page_table.load(std::memory_order_acquire)[page] + PAGE_HEADER_SIZE + slot * entry_size();
     }
 
-    size_t VariantSingleTypeContainer::entry_size() const {
-        return REFCOUNTER_SIZE + type().size(dir);
+    std::byte * VariantSingleTypeContainer::_entry_ptr(VariantIndex idx) const {
+        // entries point at their refcount
+        return _slot_ptr(idx) + layout.content_offset - REFCOUNTER_SIZE;
     }
 
-    VariantEntry VariantSingleTypeContainer::entry_at(VariantIndex idx) const {
-        if (idx >= _length) return VariantEntry::INVALID_ENTRY;
-        void * entry_ptr = reinterpret_cast<std::byte *>(_ptr) + (entry_size() * idx);
-        return VariantEntry(entry_ptr, type_id);
-    }
+    VariantIndex VariantSingleTypeContainer::_index_of_ptr(const void * ptr) const {
+        auto page_count = _page_count.load(std::memory_order_acquire);
+        if (page_count == 0) return INVALID_VARIANT_INDEX;
 
-    VariantEntry VariantSingleTypeContainer::entry_at_ptr(void * ptr) const {
-        if (ptr < _ptr || ptr >= (reinterpret_cast<std::byte *>(_ptr) + _length * entry_size())) {
-            return VariantEntry::INVALID_ENTRY;
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        auto * page = reinterpret_cast<std::byte *>(addr & ~(static_cast<uintptr_t>(_page_size) - 1));
+        auto & header = *reinterpret_cast<const VariantPageHeader *>(page);
+
+        // the header alone could belong to another container's page
+        if (header.page_index >= page_count || _page_table.load(std::memory_order_acquire)[header.page_index] != page) {
+            return INVALID_VARIANT_INDEX;
         }
 
-        ptrdiff_t relative = reinterpret_cast<std::byte *>(ptr) - reinterpret_cast<std::byte *>(_ptr);
-        VariantIndex entry_idx = static_cast<VariantIndex>(static_cast<size_t>(relative) / entry_size());
-        return entry_at(entry_idx);
+        auto offset = static_cast<size_t>(addr - reinterpret_cast<uintptr_t>(page));
+        if (offset < PAGE_HEADER_SIZE) return INVALID_VARIANT_INDEX;
+
+        auto slot = (offset - PAGE_HEADER_SIZE) / entry_size();
+        if (slot >= _entries_per_page) return INVALID_VARIANT_INDEX;
+
+        auto idx = static_cast<VariantIndex>(header.page_index * _entries_per_page + slot);
+        if (idx >= _length.load(std::memory_order_acquire)) return INVALID_VARIANT_INDEX;
+        return idx;
     }
 
-    VariantIndex VariantSingleTypeContainer::index_of(VariantEntry entry) const {
-        if (entry.ptr() < _ptr || entry.ptr() >= (reinterpret_cast<std::byte *>(_ptr) + _length * entry_size())) {
-            return INVALID_VARIANT_INDEX;
-        }
+    const VariantType & VariantSingleTypeContainer::type() const {
+        return dir.resolve(type_id);
+    }
 
-        ptrdiff_t relative = reinterpret_cast<std::byte *>(entry.ptr()) - reinterpret_cast<std::byte *>(_ptr);
-        VariantIndex entry_idx = static_cast<VariantIndex>(static_cast<size_t>(relative) / entry_size());
-        return entry_idx;
+    VariantEntry VariantSingleTypeContainer::entry_at(VariantIndex idx) const {
+        if (idx >= _length.load(std::memory_order_acquire)) return VariantEntry::INVALID_ENTRY;
+        return VariantEntry(_entry_ptr(idx), type_id);
     }
 
-    VariantEntry VariantSingleTypeContainer::alloc() {
-        if (_alloc_counter == _capacity / RECLAIM_THRESHOLD_FACTOR) {
-            _alloc_counter = 0;
-            reclaim();
-        } else _alloc_counter += 1;
+    VariantEntry VariantSingleTypeContainer::entry_at_ptr(void * ptr) const {
+        auto idx = _index_of_ptr(ptr);
+        if (idx == INVALID_VARIANT_INDEX) return VariantEntry::INVALID_ENTRY;
+        return entry_at(idx);
+    }
 
-        while (_pos < _length && entry_at(_pos).refcount() > 0) {
-            _pos += 1;
-        }
+    VariantIndex VariantSingleTypeContainer::index_of(VariantEntry entry) const {
+        return _index_of_ptr(entry.ptr());
+    }
 
-        if (_pos == _capacity) {
-            _enlarge();
-        }
+    VariantEntry VariantSingleTypeContainer::alloc() {
+        auto lock = std::lock_guard(_alloc_mutex);
 
-        if (_pos == _length) {
-            _length += 1;
+        VariantIndex idx;
+        if (_free_head != NO_FREE_ENTRY) {
+            idx = _free_head;
+            _free_head = entry_at(idx).refcount_field() & VariantEntry::FREE_NEXT_MASK;
+            _free_count -= 1;
+        } else {
+            idx = _length.load(std::memory_order_relaxed);
+            if (idx == _capacity && !_enlarge()) {
+                throw std::bad_alloc();
+            }
+            _length.store(idx + 1, std::memory_order_release);
         }
 
-        auto entry = entry_at(_pos);
+        auto entry = entry_at(idx);
         std::byte * entry_ptr = reinterpret_cast<std::byte *>(entry.ptr());
+        std::fill(entry_ptr, entry_ptr + REFCOUNTER_SIZE + layout.size, static_cast<std::byte>(0));
 
+        return entry;
+    }
 
-        std::fill(entry_ptr, entry_ptr + entry_size(), static_cast<std::byte>(0));
+    void VariantSingleTypeContainer::reserve(VariantIndex count) {
+        auto lock = std::lock_guard(_alloc_mutex);
+        if (count <= _free_count) return;
 
-        return entry;
+        auto needed = count - _free_count;
+        auto length = _length.load(std::memory_order_relaxed);
+        while (_capacity - length < needed) {
+            if (!_enlarge()) throw std::bad_alloc();
+        }
     }
 
     void VariantSingleTypeContainer::incref(VariantEntry ent) {
-        ent.refcount_field() += 1;
+        ent.atomic_refcount().fetch_add(1, std::memory_order_relaxed);
     }
 
-    void VariantSingleTypeContainer::decref(VariantEntry ent) {
-        if (ent.refcount() > 0) {
-            ent.refcount_field() -= 1;
-        }
+    uint32_t VariantSingleTypeContainer::decref(VariantEntry ent) {
+        auto refcount = ent.atomic_refcount();
+        auto prev = refcount.load(std::memory_order_relaxed);
+        while (prev > 0 && (prev & VariantEntry::FREE_BIT) == 0 && !refcount.compare_exchange_weak(prev, prev - 1, std::memory_order_acq_rel)) {}
+        if ((prev & VariantEntry::FREE_BIT) != 0) return 0;
+        return prev;
     }
 
-    std::optional<VariantReference> VariantSingleTypeContainer::reference_of(VariantEntry ent) {
-        auto * ptr = ent.ptr();
-        if (ptr < _ptr || ptr >= (reinterpret_cast<std::byte *>(_ptr) + _length * entry_size())) {
-            return std::nullopt;
-        }
+    void VariantSingleTypeContainer::free(VariantEntry ent) {
+        auto lock = std::lock_guard(_alloc_mutex);
+
+        auto idx = _index_of_ptr(ent.ptr());
+        if (idx == INVALID_VARIANT_INDEX) return;
 
-        ptrdiff_t relative = reinterpret_cast<std::byte *>(ptr) - reinterpret_cast<std::byte *>(_ptr);
-        size_t entry_idx = static_cast<size_t>(relative) / entry_size();
-        return VariantReference(ent.type_id, entry_idx);
+        ent.atomic_refcount().store(VariantEntry::FREE_BIT | _free_head, std::memory_order_relaxed);
+        _free_head = idx;
+        _free_count += 1;
     }
 
-    void VariantSingleTypeContainer::reclaim() {
-        _pos = 0;
+    std::optional<VariantReference> VariantSingleTypeContainer::reference_of(VariantEntry ent) {
+        auto idx = _index_of_ptr(ent.ptr());
+        if (idx == INVALID_VARIANT_INDEX) return std::nullopt;
+        return VariantReference(ent.type_id, idx);
     }
 
     void VariantSingleTypeContainer::debug_mem() {
+        auto lock = std::lock_guard(_alloc_mutex);
+        auto length = _length.load(std::memory_order_relaxed);
+
+        std::cout << "PAGES: " << page_count() << " (" << _entries_per_page << " entries, " << _page_size << " bytes each)\n";
         std::cout << "CAPACITY: " << _capacity << "\n";
         std::cout << "CAPACITY (bytes): " << (_capacity * entry_size()) << "\n";
-        std::cout << "LENGTH: " << _length << "\n";
-        std::cout << "LENGTH (bytes): " << (_length * entry_size()) << "\n";
-
-        std::byte * ptr = reinterpret_cast<std::byte *>(_ptr);
-        for (size_t i = 0; i < _length * entry_size(); i++) {
-            if (i % entry_size() == 0) std::cout << "[";
-
-            std::cout << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(ptr[i]);
-            if (i % entry_size() == sizeof(int32_t) - 1) std::cout << "]";
-            std::cout << " ";
-            if (i % 4 == 3) std::cout << "   ";
+        std::cout << "LENGTH: " << length << "\n";
+        std::cout << "LENGTH (bytes): " << (length * entry_size()) << "\n";
+
+        for (VariantIndex idx = 0; idx < length; idx++) {
+            auto * ptr = _slot_ptr(idx);
+            std::cout << "[";
+            for (size_t i = 0; i < entry_size(); i++) {
+                std::cout << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(ptr[i]);
+                if (i == layout.content_offset - 1) std::cout << "]";
+                std::cout << " ";
+                if (i % 4 == 3) std::cout << "   ";
+            }
+            std::cout << std::dec << "\n";
         }
-        std::cout << "\n";
     }
 
     VariantSingleTypeContainer::~VariantSingleTypeContainer() {
-        if (_ptr != nullptr) free(_ptr);
+        auto * table = _page_table.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < _page_count.load(std::memory_order_relaxed); i++) {
+            std::free(table[i]);
+        }
     }
 
     VariantContainer::VariantContainer(VariantTypeDirectory & dir)
-    : dir(dir)
-    {}
+    : _containers()
+    , _ev()
+    , dir(dir)
+    , strings()
+    {
+        for (auto & type : dir.types()) {
+            _create_container_of(type);
+        }
+
+        _ev.add(dir.type_added, [this](VariantTypeDirectory &, VariantTypeID type_id) {
+            _create_container_of(this->dir.resolve(type_id));
+        });
+    }
 
     VariantEntry VariantContainer::entry_of_content(const VariantEntryContent & content) const {
         if (dir.resolve(content.root_type_id).is_singleton_type()) return VariantEntry(nullptr, content.root_type_id);
@@ -256,22 +413,18 @@ namespace smen {
         return alloc.entry_at_ptr(content.ptr());
     }
 
-    VariantSingleTypeContainer & VariantContainer::get_container_of(VariantTypeID type_id) const {
-        auto it = _alloc_map.find(type_id);
-        if (it != _alloc_map.end()) {
-            return it->second;
-        }
-
-        auto & type = dir.resolve(type_id);
-        if (type.is_singleton_type()) throw std::runtime_error("get_container_of on singleton type");
-        bool requires_ctor = false;
-        bool requires_dtor = false;
-        _determine_ctor_dtor_behavior(type, requires_ctor, requires_dtor);
+    void VariantContainer::_create_container_of(const VariantType & type) {
+        // singleton types have no storage
+        if (!type.valid() || type.is_singleton_type()) return;
 
+        if (type.id >= _containers.size()) _containers.resize(type.id + 1);
+        _containers[type.id] = std::make_unique<VariantSingleTypeContainer>(dir, VariantTypeLayout::compile(dir, type));
+    }
 
-        auto alloc = VariantSingleTypeContainer(dir, type_id, requires_ctor, requires_dtor);
-        _alloc_map.emplace(type_id, std::move(alloc));
-        return _alloc_map.at(type_id);
+    void VariantContainer::_throw_no_container(VariantTypeID type_id) const {
+        auto & type = dir.resolve(type_id);
+        if (!type.valid()) throw std::runtime_error("get_container_of on invalid type");
+        throw std::runtime_error("get_container_of on singleton type");
     }
 
     VariantEntry VariantContainer::alloc(VariantTypeID type_id) {
@@ -281,13 +434,21 @@ namespace smen {
         auto & alloc = get_container_of(type_id);
         auto ent = alloc.alloc();
 
-        if (alloc.requires_ctor) {
-            _construct(dir.resolve(type_id), ent.content());
+        if (alloc.layout.requires_ctor) {
+            _construct(alloc.layout, ent.content());
         }
 
         return ent;
     }
 
+    void VariantContainer::reserve(VariantTypeID type_id, size_t count) {
+        if (dir.resolve(type_id).is_singleton_type()) return;
+        if (type_id >= _containers.size() || !_containers[type_id]) return;
+
+        if (count > VariantSingleTypeContainer::NO_FREE_ENTRY) throw std::bad_alloc();
+        _containers[type_id]->reserve(static_cast<VariantIndex>(count));
+    }
+
     VariantEntry VariantContainer::entry_at(VariantTypeID type_id, VariantIndex idx) const {
         // 0 size types have a single static entry
         if (dir.resolve(type_id).is_singleton_type()) return VariantEntry(nullptr, type_id);
@@ -321,11 +482,11 @@ namespace smen {
 
         auto & alloc = get_container_of(ent.type_id);
 
-        if (ent.refcount() == 1 && alloc.requires_dtor) {
-            _destroy(dir.resolve(ent.type_id), ent.content());
+        // only the thread that drops the last reference destroys the entry
+        if (alloc.decref(ent) == 1) {
+            if (alloc.layout.requires_dtor) _destroy(alloc.layout, ent.content());
+            alloc.free(ent);
         }
-
-        alloc.decref(ent);
     }
 
     VariantReference VariantContainer::reference_of(VariantEntry ent) {
@@ -339,6 +500,10 @@ namespace smen {
         return *alloc.reference_of(ent);
     }
 
+    const VariantTypeLayout & VariantContainer::layout_of(VariantTypeID type_id) const {
+        return get_container_of(type_id).layout;
+    }
+
     VariantEntry VariantContainer::resolve(VariantReference ref) {
         if (dir.resolve(ref.type_id).is_singleton_type()) return VariantEntry(nullptr, ref.type_id);
         return get_container_of(ref.type_id).entry_at(ref.index);
@@ -0,0 +1,54 @@
+#include <smen/variant/string_table.hpp>
+#include <cassert>
+#include <mutex>
+
+namespace smen {
+    VariantStringTable::VariantStringTable()
+    : _strings()
+    , _handles()
+    , _mutex()
+    {
+        _strings.emplace_back();
+        _handles.emplace(_strings.back(), VariantStringHandle(VariantName::EMPTY_HANDLE));
+    }
+
+    VariantStringTable::VariantStringTable(VariantStringTable && other)
+    : _strings()
+    , _handles()
+    , _mutex()
+    {
+        auto lock = std::unique_lock(other._mutex);
+        // moving a deque keeps its elements in place, so the keys stay valid
+        _strings = std::move(other._strings);
+        _handles = std::move(other._handles);
+    }
+
+    VariantName VariantStringTable::intern(std::string_view str) {
+        {
+            auto lock = std::shared_lock(_mutex);
+            auto it = _handles.find(str);
+            if (it != _handles.end()) return VariantName { .handle = it->second };
+        }
+
+        auto lock = std::unique_lock(_mutex);
+        // may have been added between releasing and taking the lock
+        auto it = _handles.find(str);
+        if (it != _handles.end()) return VariantName { .handle = it->second };
+
+        auto handle = static_cast<VariantStringHandle>(_strings.size());
+        _strings.emplace_back(str);
+        _handles.emplace(_strings.back(), handle);
+        return VariantName { .handle = handle };
+    }
+
+    const std::string & VariantStringTable::at(VariantName name) const {
+        auto lock = std::shared_lock(_mutex);
+        assert(name.handle < _strings.size() && "name from a different string table");
+        return _strings[name.handle];
+    }
+
+    size_t VariantStringTable::size() const {
+        auto lock = std::shared_lock(_mutex);
+        return _strings.size();
+    }
+}
@@ -1,9 +1,12 @@
 #include <smen/variant/type_builder.hpp>
+#include <algorithm>
+#include <numeric>
 
 namespace smen {
     VariantTypeBuilder::VariantTypeBuilder(VariantTypeDirectory & dir, VariantTypeCategory category, const std::string & name)
     : _type(VariantType(category, name))
-    , _cur_offset_bytes(0)
+    , _fields()
+    , _reorder_fields(false)
     , dir(dir)
     {}
 
@@ -14,13 +17,16 @@ namespace smen {
         if (type.category == VariantTypeCategory::COMPONENT) {
             throw std::runtime_error("variants cannot have fields with types of the COMPONENT category");
         }
-        _type.add_field(VariantTypeField(name, type.id, attrib, _cur_offset_bytes));
-        _cur_offset_bytes += type.size(dir);
+        _fields.emplace_back(VariantTypeBuilderField {
+            .name = name,
+            .type_id = type.id,
+            .attributes = attrib
+        });
         return *this;
     }
 
     VariantTypeBuilder & VariantTypeBuilder::field(const std::string & name, VariantTypeID type_id, VariantTypeFieldAttribute attrib) {
-        auto type = dir.resolve(type_id);
+        auto & type = dir.resolve(type_id);
         if (type.category == VariantTypeCategory::COMPONENT) {
             throw std::runtime_error("variants cannot have fields with types of the COMPONENT category");
         }
@@ -41,11 +47,41 @@ namespace smen {
         return *this;
     }
 
-    VariantType VariantTypeBuilder::build() {
-        return _type;
+    VariantTypeBuilder & VariantTypeBuilder::reorder_fields(bool reorder) {
+        _reorder_fields = reorder;
+        return *this;
+    }
+
+    VariantType VariantTypeBuilder::build() const {
+        auto placement_order = std::vector<size_t>(_fields.size());
+        std::iota(placement_order.begin(), placement_order.end(), 0);
+
+        if (_reorder_fields) {
+            // field sizes are multiples of their alignment, so placing the
+            // most aligned fields first leaves no padding between fields
+            std::stable_sort(placement_order.begin(), placement_order.end(), [&](size_t lhs, size_t rhs) {
+                return dir.resolve(_fields[lhs].type_id).alignment() > dir.resolve(_fields[rhs].type_id).alignment();
+            });
+        }
+
+        auto offsets = std::vector<size_t>(_fields.size());
+        size_t offset = 0;
+        for (auto idx : placement_order) {
+            auto & type = dir.resolve(_fields[idx].type_id);
+            auto align = type.alignment();
+            offset = (offset + align - 1) / align * align;
+            offsets[idx] = offset;
+            offset += type.size();
+        }
+
+        auto type = _type;
+        for (size_t i = 0; i < _fields.size(); i++) {
+            type.add_field(VariantTypeField(_fields[i].name, _fields[i].type_id, _fields[i].attributes, offsets[i]));
+        }
+        return type;
     }
 
     VariantTypeID VariantTypeBuilder::commit() {
-        return dir.add(_type);
+        return dir.add(build());
     }
 }
@@ -3,13 +3,24 @@
 #include <smen/ser/serialization.hpp>
 #include <sstream>
 #include <vector>
+#include <algorithm>
+#include <cassert>
 
 namespace smen {
-    void VariantType::_recalculate_total_size(const VariantTypeDirectory & dir) const {
-        _cached_size = 0;
-        for (auto & pair : _field_map) {
-            _cached_size += dir.resolve(pair.second.type_id).size(dir);
+    void VariantType::_compute_size_and_alignment(const VariantTypeDirectory & dir) {
+        // types without fields keep the size of their category
+        if (_fields.empty()) return;
+
+        // fields can only be of types that are already in the directory
+        _alignment = initial_alignment_of_category(category);
+        size_t end = 0;
+        for (auto & field : _fields) {
+            auto & field_type = dir.resolve(field.type_id);
+            _alignment = std::max(_alignment, field_type.alignment());
+            end = std::max(end, field.offset_bytes + field_type.size());
         }
+
+        _size = (end + _alignment - 1) / _alignment * _alignment;
     }
 
     const VariantType VariantType::INVALID = VariantType(VariantTypeCategory::INVALID, INVALID_VARIANT_TYPE_ID, "<Invalid>");
@@ -32,6 +43,8 @@ namespace smen {
             return sizeof(bool);
         case VariantTypeCategory::STRING:
             return sizeof(std::string);
+        case VariantTypeCategory::NAME:
+            return sizeof(VariantName);
         case VariantTypeCategory::REFERENCE:
             return sizeof(VariantReference);
         case VariantTypeCategory::LIST:
@@ -44,8 +57,41 @@ namespace smen {
         }
     }
 
+    size_t VariantType::initial_alignment_of_category(VariantTypeCategory category) {
+        switch(category) {
+        case VariantTypeCategory::INT32:
+            return alignof(int32_t);
+        case VariantTypeCategory::UINT32:
+            return alignof(uint32_t);
+        case VariantTypeCategory::INT64:
+            return alignof(int64_t);
+        case VariantTypeCategory::UINT64:
+            return alignof(uint64_t);
+        case VariantTypeCategory::FLOAT32:
+            return alignof(float);
+        case VariantTypeCategory::FLOAT64:
+            return alignof(double);
+        case VariantTypeCategory::BOOLEAN:
+            return alignof(bool);
+        case VariantTypeCategory::STRING:
+            return alignof(std::string);
+        case VariantTypeCategory::NAME:
+            return alignof(VariantName);
+        case VariantTypeCategory::REFERENCE:
+            return alignof(VariantReference);
+        case VariantTypeCategory::LIST:
+            return alignof(std::vector<VariantIndex>);
+        case VariantTypeCategory::COMPLEX:
+        case VariantTypeCategory::COMPONENT:
+        case VariantTypeCategory::INVALID:
+        default:
+            return 1;
+        }
+    }
+
     VariantType::VariantType(VariantTypeCategory cat, VariantTypeID element_type_id, const std::string & name)
-    : _cached_size(initial_size_of_category(cat))
+    : _size(initial_size_of_category(cat))
+    , _alignment(initial_alignment_of_category(cat))
     , _offset_bytes_counter(0)
     , category(cat)
     , generic_category(VariantGenericCategory::NON_GENERIC)
@@ -59,40 +105,31 @@ namespace smen {
     VariantType::VariantType(VariantTypeCategory cat, const std::string & name)
     : VariantType(cat, INVALID_VARIANT_TYPE_ID, name) {}
 
-    size_t VariantType::size(const VariantTypeDirectory & dir) const {
-        if (_cached_size != 0) return _cached_size;
-        _recalculate_total_size(dir);
-        return _cached_size;
-    }
-
     bool VariantType::is_singleton_type() const {
-        if (is_compound_type() && _field_key_list.size() == 0) return true;
+        if (is_compound_type() && _fields.empty()) return true;
         return false;
     }
 
     void VariantType::add_field(const VariantTypeField & field) {
-        _field_key_list.emplace_back(field.name);
-        _field_map.insert({field.name, field});
-        _cached_size = 0;
+        _field_index_map.insert({field.name, _fields.size()});
+        _fields.emplace_back(field);
     }
 
     const VariantTypeField & VariantType::field(const std::string & name) const {
-        auto it = _field_map.find(name);
-        if (it == _field_map.end()) return VariantTypeField::INVALID;
-        return it->second;
+        auto it = _field_index_map.find(name);
+        if (it == _field_index_map.end()) return VariantTypeField::INVALID;
+        return _fields[it->second];
     }
 
     const VariantTypeField & VariantType::field(VariantTypeFieldIndex idx) const {
-        if (idx >= _field_key_list.size()) return VariantTypeField::INVALID;
-        return _field_map.at(_field_key_list.at(idx));
+        if (idx >= _fields.size()) return VariantTypeField::INVALID;
+        return _fields[idx];
     }
 
-    const std::unordered_map<std::string, VariantTypeField> VariantType::fields() const {
-        return _field_map;
-    }
-
-    const std::vector<std::string> VariantType::ordered_field_keys() const {
-        return _field_key_list;
+    std::optional<VariantTypeFieldIndex> VariantType::field_index(const std::string & name) const {
+        auto it = _field_index_map.find(name);
+        if (it == _field_index_map.end()) return std::nullopt;
+        return it->second;
     }
 
     bool VariantType::is_compound_type() const {
@@ -106,14 +143,14 @@ namespace smen {
     void VariantType::write_string(std::ostream & s, const VariantTypeDirectory & dir) const {
         s << "VariantType(";
         s << name;
-        if (_field_map.size() > 0) {
+        if (!_fields.empty()) {
             s << " {";
             bool first = true;
-            for (auto & pair : _field_map) {
+            for (auto & field : _fields) {
                 if (!first) s << ", ";
                 first = false;
 
-                s << pair.first << " -> " << dir.resolve(pair.second.type_id).name;
+                s << field.name << " -> " << dir.resolve(field.type_id).name;
             }
             s << "}";
         }
@@ -123,14 +160,14 @@ namespace smen {
     void VariantType::write_string(std::ostream & s) const {
         s << "VariantType(";
         s << name;
-        if (_field_map.size() > 0) {
+        if (!_fields.empty()) {
             s << " {";
             bool first = true;
-            for (auto & pair : _field_map) {
+            for (auto & field : _fields) {
                 if (!first) s << ", ";
                 first = false;
 
-                s << pair.first << " -> " << pair.second.type_id;
+                s << field.name << " -> " << field.type_id;
             }
             s << "}";
         }
@@ -262,8 +299,9 @@ namespace smen {
         _reference_dtor = dtor_db.reg("builtin/reference", [](VariantContainer & alloc, const VariantType & type, const VariantEntryContent & content) {
             auto ref_value = VariantReference::read(type.element_type_id, content.ptr());
             if (ref_value) {
-                auto & type_alloc = alloc.get_container_of(ref_value.type_id);
-                type_alloc.decref(type_alloc.entry_at(ref_value.index));
+                // through the container, so that the referenced entry
+                // is destroyed and freed along with its last reference
+                alloc.decref(alloc.entry_at(ref_value.type_id, ref_value.index));
             }
         });
         reference_type.dtor = _reference_dtor.id();
@@ -290,6 +328,9 @@ namespace smen {
         list_type.dtor = _list_dtor.id();
         list_type.generic_category = VariantGenericCategory::GENERIC_BASE;
         _list = _add_builtin(std::move(list_type));
+
+        // entries are zero-filled, which is already the empty name
+        _name = _add_builtin(VariantType(VariantTypeCategory::NAME, next_id(), "Name"));
     }
 
     VariantTypeID VariantTypeDirectory::next_id() const {
@@ -303,10 +344,11 @@ namespace smen {
     }
 
     VariantTypeID VariantTypeDirectory::add(const VariantType & type) {
-        _type_map.insert({_id_counter, type});
-        _type_name_map.insert({type.name, _id_counter});
+        // IDs are handed out sequentially, so the ID is also the index
+        assert(_id_counter == _types.size());
 
-        auto & type_ref = _type_map.at(_id_counter);
+        auto & type_ref = _types.emplace_back(type);
+        _type_name_map.insert({type.name, _id_counter});
 
         type_ref.id = _id_counter;
 
@@ -314,15 +356,11 @@ namespace smen {
             type_ref.source_type_id = type_ref.id;
         }
 
-        _id_counter += 1;
-        return _id_counter - 1;
-    }
+        type_ref._compute_size_and_alignment(*this);
 
-    const VariantType & VariantTypeDirectory::resolve(VariantTypeID id) const {
-        if (id == INVALID_VARIANT_TYPE_ID) return VariantType::INVALID;
-        auto it = _type_map.find(id);
-        if (it == _type_map.end()) return VariantType::INVALID;
-        return it->second;
+        _id_counter += 1;
+        type_added(*this, type_ref.id);
+        return type_ref.id;
     }
 
     const VariantType & VariantTypeDirectory::resolve(const std::string & name) {
@@ -342,10 +380,7 @@ namespace smen {
         auto id_it = _type_name_map.find(name);
         if (id_it == _type_name_map.end()) return VariantType::INVALID;
 
-        auto it = _type_map.find(id_it->second);
-        if (it == _type_map.end()) return VariantType::INVALID;
-
-        return it->second;
+        return resolve(id_it->second);
     }
 
     const VariantType & VariantTypeDirectory::make_generic(VariantTypeID id, VariantTypeID element_type_id) {
@@ -363,11 +398,11 @@ namespace smen {
             new_type.source_type_id = id;
             auto new_type_id = add(new_type);
 
-            _generic_type_map.insert({VariantTypeSpecialization(id, element_type_id), new_type});
+            _generic_type_map.insert({VariantTypeSpecialization(id, element_type_id), new_type_id});
 
             return resolve(new_type_id);
         }
-        return it->second;
+        return resolve(it->second);
     }
 
     std::ostream & operator <<(std::ostream & s, VariantTypeCategory cat) {
@@ -379,6 +414,7 @@ namespace smen {
         case VariantTypeCategory::FLOAT32: s << "float32"; break;
         case VariantTypeCategory::FLOAT64: s << "float64"; break;
         case VariantTypeCategory::STRING: s << "string"; break;
+        case VariantTypeCategory::NAME: s << "name"; break;
         case VariantTypeCategory::BOOLEAN: s << "boolean"; break;
         case VariantTypeCategory::REFERENCE: s << "reference"; break;
         case VariantTypeCategory::LIST: s << "list"; break;
@@ -389,5 +425,6 @@ namespace smen {
             s << "invalid";
             break;
         }
+        return s;
     }
 }
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cassert>
 #include <sstream>
+#include <cstring>
 
 namespace smen {
     size_t Variant::HashFunction::operator ()(const Variant & variant) const {
@@ -16,6 +17,7 @@ namespace smen {
         case VariantStorageMode::PRIMITIVE_FLOAT64: return std::hash<double>()(variant._f64);
         case VariantStorageMode::PRIMITIVE_STRING: return std::hash<std::string>()(variant._str);
         case VariantStorageMode::PRIMITIVE_BOOLEAN: return std::hash<bool>()(variant._bool);
+        case VariantStorageMode::PRIMITIVE_NAME: return std::hash<VariantStringHandle>()(variant._name.handle);
         case VariantStorageMode::HEAP:
             return VariantEntryContent::HashFunction()(variant._content);
         default:
@@ -36,6 +38,7 @@ namespace smen {
         case VariantTypeCategory::FLOAT64: return Variant(container, double(0));
         case VariantTypeCategory::STRING: return Variant(container, std::string());
         case VariantTypeCategory::BOOLEAN: return Variant(container, false);
+        case VariantTypeCategory::NAME: return Variant(container, VariantName { .handle = VariantName::EMPTY_HANDLE });
         default:
             return Variant(container, container.alloc(type.id).content(), type.id);
         }
@@ -73,7 +76,11 @@ namespace smen {
             _bool = other._bool;
             break;
         case VariantStorageMode::PRIMITIVE_STRING:
-            _str = other._str;
+            // the string member isn't alive yet, see operator =
+            std::construct_at(&_str, other._str);
+            break;
+        case VariantStorageMode::PRIMITIVE_NAME:
+            _name = other._name;
             break;
         case VariantStorageMode::HEAP:
             std::construct_at(&_content, other._content);
@@ -88,6 +95,7 @@ namespace smen {
     : _storage_mode(other._storage_mode)
     , _container(other._container)
     , _type_id(other._type_id)
+    , _type(other._type)
     {
         _sync_storage(other);
     }
@@ -96,6 +104,7 @@ namespace smen {
     : _storage_mode(other._storage_mode)
     , _container(other._container)
     , _type_id(other._type_id)
+    , _type(other._type)
     {
         _sync_storage(other);
         if (other._storage_mode == VariantStorageMode::HEAP) {
@@ -105,16 +114,24 @@ namespace smen {
     }
 
     Variant & Variant::operator=(const Variant & other) {
+        if (this == &other) return *this;
+        if (_storage_mode == VariantStorageMode::PRIMITIVE_STRING) std::destroy_at(&_str);
+
         _storage_mode = other._storage_mode;
         _type_id = other._type_id;
+        _type = other._type;
         _container = other._container;
         _sync_storage(other);
         return *this;
     }
 
     Variant & Variant::operator=(Variant && other) {
+        if (this == &other) return *this;
+        if (_storage_mode == VariantStorageMode::PRIMITIVE_STRING) std::destroy_at(&_str);
+
         _storage_mode = other._storage_mode;
         _type_id = other._type_id;
+        _type = other._type;
         _container = other._container;
         _sync_storage(other);
         if (other._storage_mode == VariantStorageMode::HEAP) {
@@ -130,6 +147,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_INT32)
     , _container(&container)
     , _type_id(dir().int32())
+    , _type(&dir().int32_type())
     {}
 
     Variant::Variant(VariantContainer & container, uint32_t value)
@@ -137,6 +155,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_UINT32)
     , _container(&container)
     , _type_id(dir().uint32())
+    , _type(&dir().uint32_type())
     {}
 
     Variant::Variant(VariantContainer & container, int64_t value)
@@ -144,6 +163,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_INT64)
     , _container(&container)
     , _type_id(dir().int64())
+    , _type(&dir().int64_type())
     {}
 
     Variant::Variant(VariantContainer & container, uint64_t value)
@@ -151,6 +171,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_UINT64)
     , _container(&container)
     , _type_id(dir().uint64())
+    , _type(&dir().uint64_type())
     {}
 
     Variant::Variant(VariantContainer & container, float value)
@@ -158,6 +179,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_FLOAT32)
     , _container(&container)
     , _type_id(dir().float32())
+    , _type(&dir().float32_type())
     {}
 
     Variant::Variant(VariantContainer & container, double value)
@@ -165,6 +187,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_FLOAT64)
     , _container(&container)
     , _type_id(dir().float64())
+    , _type(&dir().float64_type())
     {}
 
 
@@ -172,7 +195,8 @@ namespace smen {
     : _bool(value)
     , _storage_mode(VariantStorageMode::PRIMITIVE_BOOLEAN)
     , _container(&container)
-    , _type_id(dir().string())
+    , _type_id(dir().boolean())
+    , _type(&dir().boolean_type())
     {}
 
     Variant::Variant(VariantContainer & container, const std::string & value)
@@ -180,6 +204,15 @@ namespace smen {
     , _storage_mode(VariantStorageMode::PRIMITIVE_STRING)
     , _container(&container)
     , _type_id(dir().string())
+    , _type(&dir().string_type())
+    {}
+
+    Variant::Variant(VariantContainer & container, VariantName value)
+    : _name(value)
+    , _storage_mode(VariantStorageMode::PRIMITIVE_NAME)
+    , _container(&container)
+    , _type_id(dir().name())
+    , _type(&dir().name_type())
     {}
 
     Variant::Variant(VariantContainer & container, const VariantEntryContent & content, VariantTypeID type_id)
@@ -187,6 +220,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::HEAP)
     , _container(&container)
     , _type_id(type_id)
+    , _type(&container.dir.resolve(type_id))
     {
         _container->incref(_content.entry(*_container));
     }
@@ -196,6 +230,7 @@ namespace smen {
     , _storage_mode(VariantStorageMode::HEAP)
     , _container(&container)
     , _type_id(ref.type_id)
+    , _type(&container.dir.resolve(ref.type_id))
     {
         _container->incref(_content.entry(*_container));
     }
@@ -246,6 +281,49 @@ namespace smen {
         return _content;
     }
 
+    void Variant::_copy_contents(const Variant & other) {
+        auto & self_type = type();
+
+        if (self_type.is_compound_type()) {
+            for (auto & field : self_type.fields()) {
+                get_field(field)._copy_contents(other.get_field(field));
+            }
+            return;
+        }
+
+        if (self_type.category == VariantTypeCategory::LIST) {
+            list_clear();
+            for (size_t i = 0; i < other.list_size(); i++) {
+                list_add(other.list_get(i)->clone());
+            }
+            return;
+        }
+
+        set_variant(other);
+    }
+
+    Variant Variant::clone() const {
+        if (_storage_mode != VariantStorageMode::HEAP) return *this;
+
+        auto & self_type = type();
+        if (self_type.is_singleton_type()) return *this;
+
+        // fields of primitive types are cloned into primitive variants
+        auto copy = Variant::create(*_container, self_type);
+        if (copy._storage_mode != VariantStorageMode::HEAP) {
+            copy._copy_contents(*this);
+            return copy;
+        }
+
+        auto & type_container = _container->get_container_of(_type_id);
+        if (!type_container.layout.requires_ctor && !type_container.layout.requires_dtor) {
+            std::memcpy(copy._content.ptr(), _content.ptr(), type_container.layout.size);
+        } else {
+            copy._copy_contents(*this);
+        }
+        return copy;
+    }
+
     bool Variant::is_default_value() const {
     switch(type().category) {
     case VariantTypeCategory::INT32: return int32() == 0;
@@ -256,6 +334,7 @@ namespace smen {
     case VariantTypeCategory::FLOAT64: return float64() == 0;
     case VariantTypeCategory::BOOLEAN: return boolean() == false;
     case VariantTypeCategory::STRING: return string() == "";
+    case VariantTypeCategory::NAME: return name().handle == VariantName::EMPTY_HANDLE;
     case VariantTypeCategory::REFERENCE: return reference().null();
     case VariantTypeCategory::LIST: return list_size() == 0;
     case VariantTypeCategory::INVALID:
@@ -498,9 +577,13 @@ namespace smen {
             switch(type().category) {
             case VariantTypeCategory::STRING:
                 return *reinterpret_cast<std::string *>(_content.ptr());
+            case VariantTypeCategory::NAME:
+                return _container->strings.at(*reinterpret_cast<VariantName *>(_content.ptr()));
             }
         } else if (_storage_mode == VariantStorageMode::PRIMITIVE_STRING) {
             return _str;
+        } else if (_storage_mode == VariantStorageMode::PRIMITIVE_NAME) {
+            return _container->strings.at(_name);
         }
 
         throw TypeMismatchException(dir().string_type(), type());
@@ -512,14 +595,48 @@ namespace smen {
             case VariantTypeCategory::STRING:
                 *reinterpret_cast<std::string *>(_content.ptr()) = value;
                 return;
+            case VariantTypeCategory::NAME:
+                *reinterpret_cast<VariantName *>(_content.ptr()) = _container->strings.intern(value);
+                return;
             }
         } else if (_storage_mode == VariantStorageMode::PRIMITIVE_STRING) {
             _str = value;
             return;
+        } else if (_storage_mode == VariantStorageMode::PRIMITIVE_NAME) {
+            _name = _container->strings.intern(value);
+            return;
         }
 
         throw TypeMismatchException(dir().string_type(), type());
     }
+
+    VariantName Variant::name() const {
+        if (_storage_mode == VariantStorageMode::HEAP) { 
+            switch(type().category) {
+            case VariantTypeCategory::NAME:
+                return *reinterpret_cast<VariantName *>(_content.ptr());
+            }
+        } else if (_storage_mode == VariantStorageMode::PRIMITIVE_NAME) {
+            return _name;
+        }
+
+        throw TypeMismatchException(dir().name_type(), type());
+    }
+
+    void Variant::set_name(VariantName value) {
+        if (_storage_mode == VariantStorageMode::HEAP) { 
+            switch(type().category) {
+            case VariantTypeCategory::NAME:
+                *reinterpret_cast<VariantName *>(_content.ptr()) = value;
+                return;
+            }
+        } else if (_storage_mode == VariantStorageMode::PRIMITIVE_NAME) {
+            _name = value;
+            return;
+        }
+
+        throw TypeMismatchException(dir().name_type(), type());
+    }
 #pragma GCC diagnostic pop
 
     Variant Variant::variant() const {
@@ -565,6 +682,11 @@ namespace smen {
             case VariantTypeCategory::STRING:
                 set_string(value.string());
                 break;
+            case VariantTypeCategory::NAME:
+                // handles are only meaningful within their own container
+                if (value._container == _container) set_name(value.name());
+                else set_string(value.string());
+                break;
             case VariantTypeCategory::REFERENCE:
                 set_reference(value.reference());
                 break;
@@ -583,9 +705,9 @@ namespace smen {
             return;
         }        
 
-        for (auto & pair : self_type.fields()) {
-            auto field_variant = Variant(*_container, _content.of_field(pair.second), pair.second.type_id);
-            set_field(pair.first, field_variant);
+        for (auto & field : self_type.fields()) {
+            auto field_variant = Variant(*_container, _content.of_field(field), field.type_id);
+            set_field(field.name, field_variant);
         }
     }
 
@@ -718,6 +840,7 @@ namespace smen {
             s << (boolean() ? "true" : "false");
             break;
         case VariantTypeCategory::STRING:
+        case VariantTypeCategory::NAME:
             s << "\"" << string() << "\"";
             break;
         case VariantTypeCategory::REFERENCE:
@@ -748,11 +871,10 @@ namespace smen {
             s << type().name << " ";
             s << "{";
             bool first = true;
-            for (auto & key : type().ordered_field_keys()) {
-                auto field = type().field(key);
+            for (auto & field : type().fields()) {
                 if (!first) s << ", ";
                 first = false;
-                s << key;
+                s << field.name;
                 s << " = ";
                 get_field(field).write_contents(s);
             }
@@ -800,6 +922,9 @@ namespace smen {
             return lhs.boolean() == rhs.boolean();
         case VariantTypeCategory::STRING:
             return lhs.string() == rhs.string();
+        case VariantTypeCategory::NAME:
+            if (lhs._container == rhs._container) return lhs.name() == rhs.name();
+            return lhs.string() == rhs.string();
         case VariantTypeCategory::REFERENCE:
             return lhs.reference() == rhs.reference();
         case VariantTypeCategory::LIST:
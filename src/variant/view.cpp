@@ -0,0 +1,54 @@
+#include <smen/variant/view.hpp>
+#include <cassert>
+
+namespace smen {
+    static const Variant & require_heap_variant(const Variant & variant) {
+        if (variant.storage_mode() != VariantStorageMode::HEAP) {
+            throw VariantViewException("cannot view variant of primitive type '" + variant.type().name + "', only heap variants can be viewed");
+        }
+        return variant;
+    }
+
+    VariantView::VariantView(const Variant & variant)
+    : _ptr(require_heap_variant(variant).content_ptr().ptr())
+    , _root_type_id(variant.content_ptr().root_type_id)
+    , _type(&variant.type())
+    , _container(&variant.container())
+    {}
+
+    VariantView::VariantView(VariantContainer & container, const VariantEntryContent & content, const VariantType & type)
+    : _ptr(content.ptr())
+    , _root_type_id(content.root_type_id)
+    , _type(&type)
+    , _container(&container)
+    {}
+
+    void VariantView::_throw_mismatch(const VariantType & expected) const {
+        throw Variant::TypeMismatchException(expected, *_type);
+    }
+
+    VariantView VariantView::get_field(const std::string & field_name) const {
+        assert(_type->is_compound_type() && "VariantView must be of a COMPLEX or COMPONENT type to use ::get_field");
+
+        auto & field = _type->field(field_name);
+        assert(field && "Field must exist when using ::get_field - use ::try_get_field to avoid asserts");
+        return get_field(field);
+    }
+
+    std::optional<VariantView> VariantView::try_get_field(const std::string & field_name) const {
+        if (!_type->is_compound_type()) return std::nullopt;
+
+        auto & field = _type->field(field_name);
+        if (!field) return std::nullopt;
+        return get_field(field);
+    }
+
+    Variant VariantView::variant() const {
+        return Variant(*_container, content_ptr(), _type->id);
+    }
+
+    VariantReference VariantView::reference() const {
+        if (_type->category != VariantTypeCategory::REFERENCE) _throw_mismatch(_container->dir.reference_type());
+        return VariantReference::read(_type->element_type_id, _ptr);
+    }
+}